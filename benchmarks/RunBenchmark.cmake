@@ -0,0 +1,150 @@
+# Runs one benchmark scenario and compares its results with the checked-in baseline. The test fails if a
+# result's throughput fell or its p99 rose by more than the baseline's tolerance, if a result is not a finite
+# number, or if the scenario's baseline lacks one of its results. A scenario without any baseline is skipped
+# with a warning until one is recorded.
+# THROUGHPUT_ONLY leaves p99 out of the comparison for scenarios whose p99 has too few samples to be stable.
+# With UPDATE the scenario's results replace its baseline instead.
+#
+#   cmake -DEXECUTABLE=<path> -DSCENARIO=<name> -DARGS=<arguments> -DRESULTS=<file> -DBASELINE=<file>
+#         [-DTHROUGHPUT_ONLY=ON] [-DUPDATE=ON] -P RunBenchmark.cmake
+cmake_minimum_required(VERSION 3.19)
+
+foreach(_variable EXECUTABLE SCENARIO RESULTS BASELINE)
+    if(NOT DEFINED ${_variable})
+        message(FATAL_ERROR "${_variable} is not set")
+    endif()
+endforeach()
+
+# CMake only has integer math, so values are compared in thousandths. The results have three decimals, but
+# string(JSON) hands back very small and very large numbers in exponent notation. Values of 10^12 and more
+# saturate so that the comparisons below stay within 64 bits. Non-finite results are written as null, which
+# comes back empty and yields NAN.
+function(_to_milli _value _out)
+    if(_value STREQUAL "")
+        set(${_out} NAN PARENT_SCOPE)
+        return()
+    endif()
+    if(NOT _value MATCHES "^([0-9]+)(\\.([0-9]+))?([eE]([+-]?[0-9]+))?$")
+        message(FATAL_ERROR "${SCENARIO}: can't compare ${_value}")
+    endif()
+    set(_digits "${CMAKE_MATCH_1}${CMAKE_MATCH_3}")
+    string(LENGTH "${CMAKE_MATCH_1}" _point)
+    if(CMAKE_MATCH_5)
+        math(EXPR _point "${_point} + ${CMAKE_MATCH_5}")
+    endif()
+
+    # Digits up to the third decimal, the rest is truncated
+    math(EXPR _length "${_point} + 3")
+    if(_length LESS_EQUAL 0)
+        set(${_out} 0 PARENT_SCOPE)
+        return()
+    endif()
+    string(LENGTH "${_digits}" _digit_count)
+    while(_digit_count LESS _length)
+        string(APPEND _digits "0")
+        math(EXPR _digit_count "${_digit_count} + 1")
+    endwhile()
+    string(SUBSTRING "${_digits}" 0 ${_length} _digits)
+    string(REGEX REPLACE "^0+" "" _digits "${_digits}")
+    string(LENGTH "${_digits}" _digit_count)
+    if(_digit_count EQUAL 0)
+        set(_digits 0)
+    elseif(_digit_count GREATER 15)
+        set(_digits 999999999999999)
+    endif()
+    set(${_out} ${_digits} PARENT_SCOPE)
+endfunction()
+
+separate_arguments(_arguments UNIX_COMMAND "${ARGS}")
+file(REMOVE "${RESULTS}")
+execute_process(COMMAND "${EXECUTABLE}" ${_arguments} --results "${RESULTS}" RESULT_VARIABLE _exit_code)
+if(NOT _exit_code EQUAL 0)
+    message(FATAL_ERROR "${SCENARIO}: timeline-test ${ARGS} failed: ${_exit_code}")
+endif()
+if(NOT EXISTS "${RESULTS}")
+    message(FATAL_ERROR "${SCENARIO}: no results written to ${RESULTS}")
+endif()
+
+file(READ "${RESULTS}" _results)
+file(READ "${BASELINE}" _baseline)
+string(JSON _count LENGTH "${_results}" results)
+if(_count EQUAL 0)
+    message(FATAL_ERROR "${SCENARIO}: no results, the device may not support the scenario")
+endif()
+math(EXPR _last "${_count} - 1")
+
+if(UPDATE)
+    set(_scenario "{}")
+    foreach(_i RANGE ${_last})
+        string(JSON _name GET "${_results}" results ${_i} name)
+        string(JSON _throughput GET "${_results}" results ${_i} throughput)
+        string(JSON _p99 GET "${_results}" results ${_i} p99_us)
+        if(_throughput STREQUAL "" OR _p99 STREQUAL "")
+            message(FATAL_ERROR "${SCENARIO} ${_name}: not a finite result, no baseline recorded")
+        endif()
+        string(JSON _scenario SET "${_scenario}" "${_name}" "{\"throughput\": ${_throughput}, \"p99_us\": ${_p99}}")
+    endforeach()
+    string(JSON _baseline SET "${_baseline}" scenarios "${SCENARIO}" "${_scenario}")
+    file(WRITE "${BASELINE}" "${_baseline}\n")
+    message(STATUS "${SCENARIO}: baseline updated")
+    return()
+endif()
+
+string(JSON _scenario_type ERROR_VARIABLE _missing TYPE "${_baseline}" scenarios "${SCENARIO}")
+if(_missing)
+    # Matched by the test's SKIP_REGULAR_EXPRESSION
+    message(WARNING "${SCENARIO}: has no baseline yet, record it with the benchmark-baseline target")
+    return()
+endif()
+
+string(JSON _throughput_percent GET "${_baseline}" tolerance throughput_percent)
+string(JSON _p99_percent GET "${_baseline}" tolerance p99_percent)
+set(_regressions 0)
+foreach(_i RANGE ${_last})
+    string(JSON _name GET "${_results}" results ${_i} name)
+    string(JSON _throughput GET "${_results}" results ${_i} throughput)
+    string(JSON _p99 GET "${_results}" results ${_i} p99_us)
+    string(JSON _expected_throughput ERROR_VARIABLE _missing GET "${_baseline}" scenarios "${SCENARIO}" "${_name}" throughput)
+    if(_missing)
+        message(SEND_ERROR "${SCENARIO} ${_name}: missing from the baseline, record it with the benchmark-baseline target")
+        math(EXPR _regressions "${_regressions} + 1")
+        continue()
+    endif()
+    string(JSON _expected_p99 GET "${_baseline}" scenarios "${SCENARIO}" "${_name}" p99_us)
+
+    _to_milli("${_throughput}" _actual)
+    _to_milli("${_expected_throughput}" _expected)
+    if(_actual STREQUAL "NAN")
+        message(SEND_ERROR "${SCENARIO} ${_name}: throughput is not a finite number")
+        math(EXPR _regressions "${_regressions} + 1")
+    else()
+        math(EXPR _lhs "${_actual} * 100")
+        math(EXPR _rhs "${_expected} * (100 - ${_throughput_percent})")
+        if(_lhs LESS _rhs)
+            message(SEND_ERROR "${SCENARIO} ${_name}: throughput ${_throughput}/s, baseline ${_expected_throughput}/s - ${_throughput_percent}%")
+            math(EXPR _regressions "${_regressions} + 1")
+        endif()
+    endif()
+
+    if(NOT THROUGHPUT_ONLY)
+        _to_milli("${_p99}" _actual)
+        _to_milli("${_expected_p99}" _expected)
+        if(_actual STREQUAL "NAN")
+            message(SEND_ERROR "${SCENARIO} ${_name}: p99 is not a finite number")
+            math(EXPR _regressions "${_regressions} + 1")
+        else()
+            math(EXPR _lhs "${_actual} * 100")
+            math(EXPR _rhs "${_expected} * (100 + ${_p99_percent})")
+            if(_lhs GREATER _rhs)
+                message(SEND_ERROR "${SCENARIO} ${_name}: p99 ${_p99} us, baseline ${_expected_p99} us + ${_p99_percent}%")
+                math(EXPR _regressions "${_regressions} + 1")
+            endif()
+        endif()
+    endif()
+
+    message(STATUS "${SCENARIO} ${_name}: ${_throughput}/s (baseline ${_expected_throughput}), p99 ${_p99} us (baseline ${_expected_p99})")
+endforeach()
+
+if(_regressions GREATER 0)
+    message(FATAL_ERROR "${SCENARIO}: ${_regressions} results failed")
+endif()
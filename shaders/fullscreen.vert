@@ -0,0 +1,9 @@
+#version 450
+
+// Full-screen triangle from the vertex index, no vertex buffers
+
+void main()
+{
+    const vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// Synthetic fragment load: the same dependent ALU loop as workload.comp for every covered pixel
+
+layout(push_constant) uniform PushConstants
+{
+    uvec2 size;
+    uint iterations;
+    uint index;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 value = vec4(gl_FragCoord.xy / vec2(pc.size), pc.index, 1.0);
+    for (uint i = 0; i < pc.iterations; ++i)
+    {
+        value = fract(value * 1.618034 + sin(value.yzwx));
+    }
+    outColor = vec4(value.rgb * 0.25, 1.0);
+}
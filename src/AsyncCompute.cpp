@@ -0,0 +1,223 @@
+#include "AsyncCompute.hpp"
+#include "Common.hpp"
+
+#include <array>
+
+namespace
+{
+// Elements of four floats each compute frame runs the workload over, 8 MiB
+const uint32_t c_width = 1024;
+const uint32_t c_height = 512;
+const uint32_t c_iterations = 64;
+const VkDeviceSize c_bufferSize = static_cast<VkDeviceSize>(c_width) * c_height * 4 * sizeof(float);
+
+void allocateCommandBuffers(VkDevice device, uint32_t queueFamily, std::vector<VkCommandPool>& pools, std::vector<VkCommandBuffer>& commandBuffers)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    for (size_t i = 0; i < pools.size(); ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &pools[i]));
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]));
+    }
+}
+} // namespace
+
+void AsyncCompute::create(VkDevice device,
+                          VkPhysicalDevice physicalDevice,
+                          MemoryArena& memoryArena,
+                          uint32_t queueFamily,
+                          uint32_t graphicsQueueFamily,
+                          uint32_t overlapDepth,
+                          uint32_t framesInFlight)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_overlapDepth = overlapDepth;
+    m_framesInFlight = framesInFlight;
+
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineCreateInfo;
+    VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+
+    m_commandPools.resize(framesInFlight);
+    m_commandBuffers.resize(framesInFlight);
+    allocateCommandBuffers(m_device, queueFamily, m_commandPools, m_commandBuffers);
+    m_graphicsCommandPools.resize(framesInFlight);
+    m_graphicsCommandBuffers.resize(framesInFlight);
+    allocateCommandBuffers(m_device, graphicsQueueFamily, m_graphicsCommandPools, m_graphicsCommandBuffers);
+
+    // Compute may run overlapDepth frames ahead and graphics framesInFlight frames behind, so this many
+    // buffers keep a writer from ever having to wait for a reader that the CPU has not already waited for.
+    const std::array<uint32_t, 2> queueFamilies{queueFamily, graphicsQueueFamily};
+    const uint32_t queueFamilyCount = queueFamily == graphicsQueueFamily ? 1 : ui32Size(queueFamilies);
+
+    const uint32_t bufferCount = overlapDepth + framesInFlight;
+    m_buffers.resize(bufferCount);
+    m_bufferAllocations.resize(bufferCount);
+    for (uint32_t i = 0; i < bufferCount; ++i)
+    {
+        m_bufferAllocations[i] = m_memoryArena->createBuffer(c_bufferSize,
+                                                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                             m_buffers[i],
+                                                             MemoryArena::c_transient,
+                                                             queueFamilyCount,
+                                                             queueFamilies.data());
+    }
+    m_resultBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+
+    m_pipeline.create(m_device);
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = bufferCount;
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.maxSets = bufferCount;
+    descriptorPoolInfo.poolSizeCount = 1;
+    descriptorPoolInfo.pPoolSizes = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(m_device, &descriptorPoolInfo, nullptr, &m_descriptorPool));
+
+    m_descriptorSets.resize(bufferCount);
+    for (uint32_t i = 0; i < bufferCount; ++i)
+    {
+        m_descriptorSets[i] = m_pipeline.allocateDescriptorSet(m_descriptorPool, m_buffers[i]);
+    }
+
+    m_timestamps.create(m_device, physicalDevice, queueFamily, framesInFlight);
+}
+
+void AsyncCompute::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    m_timestamps.destroy();
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    m_descriptorSets.clear();
+    m_pipeline.destroy();
+    // Their memory goes back with the frame slots' transient memory
+    for (VkBuffer buffer : m_resultBuffers)
+    {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+    }
+    m_resultBuffers.clear();
+    for (size_t i = 0; i < m_buffers.size(); ++i)
+    {
+        m_memoryArena->destroyBuffer(m_buffers[i], m_bufferAllocations[i]);
+    }
+    for (const VkCommandPool& commandPool : m_commandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+    for (const VkCommandPool& commandPool : m_graphicsCommandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+    m_device = VK_NULL_HANDLE;
+}
+
+void AsyncCompute::waitForFrameSlot(uint32_t /*frameIndex*/)
+{
+    if (m_value < m_framesInFlight)
+    {
+        return;
+    }
+
+    const uint64_t waitValue = m_value + 1 - m_framesInFlight;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &waitValue;
+
+    VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+}
+
+void AsyncCompute::submitFrame(SubmitBatcher& submits, uint32_t frameIndex, VkSemaphore graphicsTimeline, uint64_t graphicsValue)
+{
+    VkCommandBuffer cb = m_commandBuffers[frameIndex];
+    const size_t bufferIndex = m_value % m_buffers.size();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK(vkResetCommandPool(m_device, m_commandPools[frameIndex], 0));
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+    m_timestamps.cmdBegin(cb, frameIndex);
+    if (m_value < m_buffers.size())
+    {
+        // The first frame to use a buffer clears it, so the loop never runs on whatever the memory held
+        vkCmdFillBuffer(cb, m_buffers[bufferIndex], 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    m_pipeline.cmdBind(cb, m_descriptorSets[bufferIndex]);
+    m_pipeline.cmdDispatch(cb, c_width, c_height, c_iterations, static_cast<uint32_t>(m_value));
+    m_timestamps.cmdEnd(cb, frameIndex);
+    VK_CHECK(vkEndCommandBuffer(cb));
+
+    // The buffer was last read by the graphics frame framesInFlight frames back, which graphicsValue is one
+    // frame ahead of
+    const uint64_t waitValue = graphicsValue + 1 > m_framesInFlight ? graphicsValue + 1 - m_framesInFlight : 0;
+    submits.beginBatch();
+    submits.addWait(graphicsTimeline, VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, waitValue);
+    submits.addCommandBuffer(cb);
+    // All commands, the slot's command pool and queries are reused once the CPU has waited for this value
+    submits.addSignal(m_semaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, ++m_value);
+}
+
+VkCommandBuffer AsyncCompute::recordGraphicsFrame(uint32_t frameIndex)
+{
+    const uint64_t value = graphicsWaitValue();
+    if (value == 0)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    VkCommandBuffer cb = m_graphicsCommandBuffers[frameIndex];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    // The buffer the slot's previous frame copied into is done with, and its memory has already been reset
+    vkDestroyBuffer(m_device, m_resultBuffers[frameIndex], nullptr);
+    m_memoryArena->createBuffer(c_bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_resultBuffers[frameIndex], frameIndex);
+
+    VK_CHECK(vkResetCommandPool(m_device, m_graphicsCommandPools[frameIndex], 0));
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+
+    VkBufferCopy region{};
+    region.size = c_bufferSize;
+    vkCmdCopyBuffer(cb, m_buffers[(value - 1) % m_buffers.size()], m_resultBuffers[frameIndex], 1, &region);
+    VK_CHECK(vkEndCommandBuffer(cb));
+    return cb;
+}
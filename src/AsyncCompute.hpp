@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MemoryArena.hpp"
+#include "SubmitBatcher.hpp"
+#include "Timing.hpp"
+#include "WorkloadPipeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Per-frame work on the compute queue that the graphics submission consumes. Every compute frame runs the
+// workload dispatch over one of a ring of storage buffers, and the graphics frame copies the result of the
+// compute frame it waits for. Both queues are ordered with timeline semaphores only: compute frame k signals
+// value k on its own timeline, graphics frame k waits for compute frame k - overlapDepth, and compute frame k
+// waits for the graphics frame that last read the buffer it is about to overwrite. With depth 0 the queues run
+// strictly one after another, with depth d the compute queue may run d frames ahead of graphics.
+class AsyncCompute
+{
+public:
+    void create(VkDevice device,
+                VkPhysicalDevice physicalDevice,
+                MemoryArena& memoryArena,
+                uint32_t queueFamily,
+                uint32_t graphicsQueueFamily,
+                uint32_t overlapDepth,
+                uint32_t framesInFlight);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Blocks until the compute work that last used the frame slot has finished
+    void waitForFrameSlot(uint32_t frameIndex);
+    // Records the frame's compute work and adds its batch for the compute queue. graphicsValue is the last value
+    // signaled on the graphics timeline.
+    void submitFrame(SubmitBatcher& submits, uint32_t frameIndex, VkSemaphore graphicsTimeline, uint64_t graphicsValue);
+    // Records the graphics frame's read of the buffer written by the compute frame graphicsWaitValue(), to be
+    // submitted on the graphics queue after waiting for that value. Returns null while there is none yet. The
+    // copy goes to transient memory of the frame slot, so the slot must have been reset in the memory arena.
+    VkCommandBuffer recordGraphicsFrame(uint32_t frameIndex);
+
+    VkSemaphore semaphore() const { return m_semaphore; }
+    // Last value signaled on the compute timeline
+    uint64_t value() const { return m_value; }
+    // Compute timeline value the graphics submission of the current frame has to wait for
+    uint64_t graphicsWaitValue() const { return m_value > m_overlapDepth ? m_value - m_overlapDepth : 0; }
+    // Valid after waitForFrameSlot() for the same slot
+    bool collectGpuInterval(uint32_t frameIndex, GpuInterval& interval) { return m_timestamps.collect(frameIndex, interval); }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_overlapDepth = 0;
+    uint32_t m_framesInFlight = 0;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_value = 0;
+    std::vector<VkCommandPool> m_commandPools;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+    // Per frame slot on the graphics queue family, reused once the graphics frame slot is
+    std::vector<VkCommandPool> m_graphicsCommandPools;
+    std::vector<VkCommandBuffer> m_graphicsCommandBuffers;
+    WorkloadPipeline m_pipeline;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    MemoryArena* m_memoryArena = nullptr;
+    std::vector<VkBuffer> m_buffers;
+    std::vector<MemoryArena::Allocation> m_bufferAllocations;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+    // Destination of each frame slot's copy, recreated every frame
+    std::vector<VkBuffer> m_resultBuffers;
+    GpuTimestamps m_timestamps;
+};
@@ -0,0 +1,98 @@
+#include "CommandBufferCache.hpp"
+#include "Common.hpp"
+
+#include <cstring>
+
+bool CommandBufferCache::Key::operator==(const Key& other) const
+{
+    return framebuffer == other.framebuffer && memcmp(&clearColor, &other.clearColor, sizeof(clearColor)) == 0;
+}
+
+void CommandBufferCache::create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t imageCount)
+{
+    m_device = device;
+    m_imageCount = imageCount;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    m_commandPools.resize(framesInFlight);
+    m_entries.resize(framesInFlight * imageCount);
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPools[i]));
+
+        std::vector<VkCommandBuffer> commandBuffers(imageCount);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = imageCount;
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, commandBuffers.data()));
+
+        for (uint32_t j = 0; j < imageCount; ++j)
+        {
+            m_entries[i * imageCount + j].commandBuffer = commandBuffers[j];
+        }
+    }
+}
+
+void CommandBufferCache::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    for (const VkCommandPool& commandPool : m_commandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+    m_commandPools.clear();
+    m_entries.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void CommandBufferCache::retire(DeletionQueue& deletionQueue, uint64_t value)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    for (const VkCommandPool& commandPool : m_commandPools)
+    {
+        deletionQueue.deferCommandPool(commandPool, value);
+    }
+    m_commandPools.clear();
+    m_entries.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+bool CommandBufferCache::acquire(uint32_t frameIndex, uint32_t imageIndex, const Key& key, VkCommandBuffer& cb)
+{
+    Entry& entry = m_entries[frameIndex * m_imageCount + imageIndex];
+    cb = entry.commandBuffer;
+    if (entry.valid && entry.key == key)
+    {
+        ++m_hits;
+        return true;
+    }
+
+    // Keep the memory the command buffer already has, it is recorded with the same amount of commands again
+    VK_CHECK(vkResetCommandBuffer(cb, 0));
+    entry.key = key;
+    entry.valid = true;
+    ++m_misses;
+    return false;
+}
+
+void CommandBufferCache::invalidate()
+{
+    for (Entry& entry : m_entries)
+    {
+        entry.valid = false;
+    }
+}
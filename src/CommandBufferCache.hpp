@@ -0,0 +1,57 @@
+#pragma once
+
+#include "DeletionQueue.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Primary command buffers recorded once per frame slot and framebuffer and submitted again for as long as the
+// state they were recorded with stays the same. Entries are per frame slot so that waiting for the slot also
+// guarantees the cached command buffer is no longer pending and can be resubmitted without SIMULTANEOUS_USE.
+class CommandBufferCache
+{
+public:
+    struct Key
+    {
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkClearColorValue clearColor{};
+
+        bool operator==(const Key& other) const;
+    };
+
+    void create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t imageCount);
+    void destroy();
+    // Like destroy(), but the command pools are destroyed by deletionQueue once value is reached, so that the
+    // cache can be recreated while its command buffers are still pending
+    void retire(DeletionQueue& deletionQueue, uint64_t value);
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Returns true if the command buffer of the frame slot and image was recorded with the same key and can be
+    // submitted as is. Otherwise it is reset, remembered for the key and has to be recorded by the caller.
+    bool acquire(uint32_t frameIndex, uint32_t imageIndex, const Key& key, VkCommandBuffer& cb);
+    // Forgets every entry, e.g. when the framebuffers are recreated
+    void invalidate();
+
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+    void resetCounters() { m_hits = m_misses = 0; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        bool valid = false;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_imageCount = 0;
+    std::vector<VkCommandPool> m_commandPools;
+    // Indexed by frameIndex * m_imageCount + imageIndex
+    std::vector<Entry> m_entries;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
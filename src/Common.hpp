@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+
+const uint64_t c_timeout = 10000000000;
+
+#ifdef _MSC_VER
+const std::vector<const char*> c_validationLayers{"VK_LAYER_KHRONOS_validation"};
+#else
+const std::vector<const char*> c_validationLayers{};
+#endif
+
+#define VK_CHECK(f)                                                                             \
+    do                                                                                          \
+    {                                                                                           \
+        const VkResult result = (f);                                                            \
+        if (result != VK_SUCCESS)                                                               \
+        {                                                                                       \
+            printf("Abort. %s failed at %s:%d. Result = %d\n", #f, __FILE__, __LINE__, result); \
+            abort();                                                                            \
+        }                                                                                       \
+    } while (false)
+
+#define CHECK(f)                                                           \
+    do                                                                     \
+    {                                                                      \
+        if (!(f))                                                          \
+        {                                                                  \
+            printf("Abort. %s failed at %s:%d\n", #f, __FILE__, __LINE__); \
+            abort();                                                       \
+        }                                                                  \
+    } while (false)
+
+template<typename T>
+uint32_t ui32Size(const T& container)
+{
+    return static_cast<uint32_t>(container.size());
+}
+
+uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties);
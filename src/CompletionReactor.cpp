@@ -0,0 +1,154 @@
+#include "CompletionReactor.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <memory>
+
+void CompletionReactor::create(VkDevice device)
+{
+    m_device = device;
+
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineCreateInfo;
+    VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_wakeSemaphore));
+
+    m_wakeValue = 0;
+    m_callbackCount = 0;
+    m_stopping = false;
+    m_worker = std::thread(&CompletionReactor::workerLoop, this);
+}
+
+void CompletionReactor::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        wake();
+    }
+    m_worker.join();
+    vkDestroySemaphore(m_device, m_wakeSemaphore, nullptr);
+    m_pending.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void CompletionReactor::onValue(VkSemaphore semaphore, uint64_t value, Callback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back({semaphore, value, std::move(callback)});
+    wake();
+}
+
+std::future<void> CompletionReactor::whenValue(VkSemaphore semaphore, uint64_t value)
+{
+    // std::function needs a copyable target
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    onValue(semaphore, value, [promise](uint64_t) { promise->set_value(); });
+    return future;
+}
+
+uint64_t CompletionReactor::callbackCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_callbackCount;
+}
+
+void CompletionReactor::wake()
+{
+    VkSemaphoreSignalInfo signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.semaphore = m_wakeSemaphore;
+    signalInfo.value = ++m_wakeValue;
+    VK_CHECK(vkSignalSemaphore(m_device, &signalInfo));
+}
+
+void CompletionReactor::workerLoop()
+{
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> observedValues;
+    std::vector<Pending> ready;
+    for (;;)
+    {
+        // One entry per semaphore with the lowest value anything waits for, which is the next one to fire
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping)
+            {
+                return;
+            }
+            semaphores.assign(1, m_wakeSemaphore);
+            values.assign(1, m_wakeValue + 1);
+            for (const Pending& pending : m_pending)
+            {
+                size_t i = 1;
+                while (i < semaphores.size() && semaphores[i] != pending.semaphore)
+                {
+                    ++i;
+                }
+                if (i == semaphores.size())
+                {
+                    semaphores.push_back(pending.semaphore);
+                    values.push_back(pending.value);
+                }
+                values[i] = std::min(values[i], pending.value);
+            }
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.flags = VK_SEMAPHORE_WAIT_ANY_BIT;
+        waitInfo.semaphoreCount = ui32Size(semaphores);
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = values.data();
+        const VkResult result = vkWaitSemaphores(m_device, &waitInfo, c_timeout);
+        if (result != VK_TIMEOUT)
+        {
+            VK_CHECK(result);
+        }
+
+        observedValues.resize(semaphores.size());
+        for (size_t i = 1; i < semaphores.size(); ++i)
+        {
+            VK_CHECK(vkGetSemaphoreCounterValue(m_device, semaphores[i], &observedValues[i]));
+        }
+
+        // Anything registered since the wait started is left for the next round, whose wait returns at once
+        ready.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<Pending>::iterator end = m_pending.begin();
+            for (std::vector<Pending>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+            {
+                const size_t i = std::find(semaphores.begin() + 1, semaphores.end(), it->semaphore) - semaphores.begin();
+                if (i < semaphores.size() && it->value <= observedValues[i])
+                {
+                    ready.push_back(std::move(*it));
+                }
+                else
+                {
+                    *end++ = std::move(*it);
+                }
+            }
+            m_pending.erase(end, m_pending.end());
+            m_callbackCount += ready.size();
+        }
+
+        for (const Pending& pending : ready)
+        {
+            const size_t i = std::find(semaphores.begin() + 1, semaphores.end(), pending.semaphore) - semaphores.begin();
+            pending.callback(observedValues[i]);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Waits for every registered timeline value on its own thread with a single wait-any vkWaitSemaphores and runs
+// the completion callbacks as values are reached, so that work depending on GPU progress is driven by events
+// instead of being polled for or blocked on by the render thread. Registering wakes the thread through a host
+// signaled timeline that is always part of the wait, so new values are picked up without a timeout.
+class CompletionReactor
+{
+public:
+    // Called on the reactor thread with the value the semaphore was observed at, which may be past the one
+    // registered
+    typedef std::function<void(uint64_t)> Callback;
+
+    void create(VkDevice device);
+    // Callbacks whose values have not been reached are dropped
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Thread safe. The semaphore must be a timeline that outlives the registration.
+    void onValue(VkSemaphore semaphore, uint64_t value, Callback callback);
+    std::future<void> whenValue(VkSemaphore semaphore, uint64_t value);
+
+    uint64_t callbackCount();
+
+private:
+    struct Pending
+    {
+        VkSemaphore semaphore;
+        uint64_t value;
+        Callback callback;
+    };
+
+    void workerLoop();
+    // Must be called with m_mutex held so that the wake values are signaled in increasing order
+    void wake();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkSemaphore m_wakeSemaphore = VK_NULL_HANDLE;
+    uint64_t m_wakeValue = 0;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::vector<Pending> m_pending;
+    uint64_t m_callbackCount = 0;
+    bool m_stopping = false;
+};
@@ -0,0 +1,117 @@
+#include "DeletionQueue.hpp"
+#include "Common.hpp"
+
+void DeletionQueue::create(VkDevice device)
+{
+    m_device = device;
+}
+
+void DeletionQueue::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    collect(UINT64_MAX);
+    m_device = VK_NULL_HANDLE;
+}
+
+bool DeletionQueue::empty() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.empty();
+}
+
+void DeletionQueue::deferBuffer(VkBuffer buffer, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer, value);
+}
+
+void DeletionQueue::deferImage(VkImage image, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_IMAGE, (uint64_t)image, value);
+}
+
+void DeletionQueue::deferImageView(VkImageView imageView, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)imageView, value);
+}
+
+void DeletionQueue::deferFramebuffer(VkFramebuffer framebuffer, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t)framebuffer, value);
+}
+
+void DeletionQueue::deferSemaphore(VkSemaphore semaphore, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_SEMAPHORE, (uint64_t)semaphore, value);
+}
+
+void DeletionQueue::deferSwapchain(VkSwapchainKHR swapchain, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t)swapchain, value);
+}
+
+void DeletionQueue::deferMemory(VkDeviceMemory memory, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t)memory, value);
+}
+
+void DeletionQueue::deferCommandPool(VkCommandPool commandPool, uint64_t value)
+{
+    push(VK_OBJECT_TYPE_COMMAND_POOL, (uint64_t)commandPool, value);
+}
+
+void DeletionQueue::collect(uint64_t completedValue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_entries.empty() && m_entries.front().value <= completedValue)
+    {
+        destroyEntry(m_entries.front());
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::push(VkObjectType type, uint64_t handle, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CHECK(m_entries.empty() || m_entries.back().value <= value);
+    if (handle != 0)
+    {
+        m_entries.push_back({value, type, handle});
+    }
+}
+
+void DeletionQueue::destroyEntry(const Entry& entry)
+{
+    switch (entry.type)
+    {
+    case VK_OBJECT_TYPE_BUFFER:
+        vkDestroyBuffer(m_device, (VkBuffer)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vkDestroyImage(m_device, (VkImage)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(m_device, (VkImageView)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        vkDestroyFramebuffer(m_device, (VkFramebuffer)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_SEMAPHORE:
+        vkDestroySemaphore(m_device, (VkSemaphore)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        vkDestroySwapchainKHR(m_device, (VkSwapchainKHR)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        vkFreeMemory(m_device, (VkDeviceMemory)entry.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_COMMAND_POOL:
+        vkDestroyCommandPool(m_device, (VkCommandPool)entry.handle, nullptr);
+        break;
+    default:
+        CHECK(!"Unknown object type");
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Defers the destruction of handles retired at runtime until the GPU is done with them, so that replacing a
+// resource never needs vkDeviceWaitIdle. Each handle is queued with the value of the last submission that used
+// it, e.g. a timeline semaphore value, and collect() destroys the handles whose value has been reached. Values
+// must not decrease between pushes, which keeps the queue sorted and collect() a pop from the front. Pushing
+// and collecting are thread safe so that collect() can run from a completion callback.
+class DeletionQueue
+{
+public:
+    void create(VkDevice device);
+    // Destroys everything still queued, the device must be idle
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+    bool empty() const;
+
+    // Separate names because non-dispatchable handles are all uint64_t on 32-bit platforms
+    void deferBuffer(VkBuffer buffer, uint64_t value);
+    void deferImage(VkImage image, uint64_t value);
+    void deferImageView(VkImageView imageView, uint64_t value);
+    void deferFramebuffer(VkFramebuffer framebuffer, uint64_t value);
+    void deferSemaphore(VkSemaphore semaphore, uint64_t value);
+    void deferSwapchain(VkSwapchainKHR swapchain, uint64_t value);
+    void deferMemory(VkDeviceMemory memory, uint64_t value);
+    // Frees the command buffers allocated from it too
+    void deferCommandPool(VkCommandPool commandPool, uint64_t value);
+
+    // Destroys every handle queued with a value up to completedValue
+    void collect(uint64_t completedValue);
+
+private:
+    struct Entry
+    {
+        uint64_t value;
+        VkObjectType type;
+        uint64_t handle;
+    };
+
+    void push(VkObjectType type, uint64_t handle, uint64_t value);
+    void destroyEntry(const Entry& entry);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    mutable std::mutex m_mutex;
+    std::deque<Entry> m_entries;
+};
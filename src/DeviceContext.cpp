@@ -0,0 +1,1664 @@
+#include "DeviceContext.hpp"
+#include "Common.hpp"
+#include "SharedTimeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace
+{
+const std::vector<const char*> c_presentDeviceExtensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+const VkSurfaceFormatKHR c_windowSurfaceFormat{VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+const VkClearColorValue c_clearColor{{0.0f, 0.0f, 0.2f, 1.0f}};
+const uint32_t c_swapchainImageCount = 3;
+// Uploads are split into chunks of this size, like individual assets
+const VkDeviceSize c_uploadChunkSize = 256 * 1024;
+
+// Times a frame loop phase into the frame stats and the trace
+class PhaseTimer
+{
+public:
+    PhaseTimer(FrameStats& frameStats, TraceRecorder& trace, FramePhase phase) :
+        m_frameStats(frameStats),
+        m_trace(trace),
+        m_phase(phase),
+        m_begin(hostNanoseconds())
+    {
+    }
+
+    ~PhaseTimer()
+    {
+        const uint64_t end = hostNanoseconds();
+        m_frameStats.phase(m_phase).add(end - m_begin);
+        m_trace.span(framePhaseName(m_phase), m_begin, end);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    FrameStats& m_frameStats;
+    TraceRecorder& m_trace;
+    FramePhase m_phase;
+    uint64_t m_begin;
+};
+} // namespace
+
+const VkExtent2D DeviceContext::c_windowExtent{800, 600};
+
+void DeviceContext::getQueueFamilies()
+{
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    QueueFamilyIndices indices;
+    for (unsigned int i = 0; i < queueFamilies.size(); ++i)
+    {
+        if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
+            indices.graphicsFamily = i;
+        }
+
+        if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT)
+        {
+            indices.computeFamily = i;
+        }
+
+        // Nothing is presented in headless mode so any family satisfies the present requirement
+        VkBool32 presentSupport = m_headless;
+        if (!m_headless)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, i, m_surface, &presentSupport);
+        }
+        if (queueFamilies[i].queueCount > 0 && presentSupport)
+        {
+            indices.presentFamily = i;
+        }
+
+        if (indices.graphicsFamily != -1 && indices.computeFamily != -1 && indices.presentFamily != -1)
+        {
+            break;
+        }
+    }
+
+    // Prefer a compute-only family so that async compute runs on its own hardware queue
+    for (unsigned int i = 0; i < queueFamilies.size(); ++i)
+    {
+        if (queueFamilies[i].queueCount > 0 && (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = i;
+            break;
+        }
+    }
+
+    m_queueFamilyIndices = indices;
+}
+
+std::set<std::string> DeviceContext::getSupportedDeviceExtensions() const
+{
+    uint32_t extensionCount = 0;
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr));
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data()));
+
+    std::set<std::string> names;
+    for (const VkExtensionProperties& extension : extensions)
+    {
+        names.insert(extension.extensionName);
+    }
+    return names;
+}
+
+void DeviceContext::queryFeatures()
+{
+    const std::set<std::string> supportedExtensions = getSupportedDeviceExtensions();
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    // Feature structs of extensions are only chained if the device has the extension, the others stay zeroed
+    void** next = &timelineFeatures.pNext;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (supportedExtensions.count(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+    {
+        *next = &synchronization2Features;
+        next = &synchronization2Features.pNext;
+    }
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+    // Presents are only waited for with a swapchain
+    const bool presentWaitExtensions = !m_headless && supportedExtensions.count(VK_KHR_PRESENT_ID_EXTENSION_NAME) > 0 &&
+        supportedExtensions.count(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) > 0;
+    if (presentWaitExtensions)
+    {
+        *next = &presentIdFeatures;
+    }
+
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features);
+
+    m_timelineSemaphoreSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+    m_synchronization2Supported = synchronization2Features.synchronization2 == VK_TRUE;
+    m_presentWaitSupported = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+    if (!m_timelineSemaphoreSupported)
+    {
+        printf("Timeline semaphores not supported, only fence and binary sync are available\n");
+    }
+}
+
+void DeviceContext::createDevice()
+{
+    const std::set<int> uniqueQueueFamilies = //
+        {
+            m_queueFamilyIndices.graphicsFamily,
+            m_queueFamilyIndices.computeFamily,
+            m_queueFamilyIndices.presentFamily //
+        };
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // When compute shares the graphics family, take a second queue from it if there is one so that
+    // async compute submissions are not serialized behind graphics on the same queue
+    const bool sharedComputeFamily = m_queueFamilyIndices.computeFamily == m_queueFamilyIndices.graphicsFamily;
+    const uint32_t computeQueueIndex = sharedComputeFamily && queueFamilies[m_queueFamilyIndices.computeFamily].queueCount > 1 ? 1 : 0;
+
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    const std::array<float, 2> queuePriorities{1.0f, 1.0f};
+    for (int queueFamily : uniqueQueueFamilies)
+    {
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
+        queueCreateInfo.queueCount = queueFamily == m_queueFamilyIndices.computeFamily ? computeQueueIndex + 1 : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
+
+    VkPhysicalDeviceFeatures deviceFeatures{};
+    VkPhysicalDeviceVulkan12Features device12Features{};
+    device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    device12Features.timelineSemaphore = m_timelineSemaphoreSupported;
+
+    const std::set<std::string> supportedExtensions = getSupportedDeviceExtensions();
+    std::vector<const char*> deviceExtensions;
+    if (m_timelineSemaphoreSupported && supportedExtensions.count(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+    if (m_synchronization2Supported)
+    {
+        deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    }
+    m_calibratedTimestampsSupported = supportedExtensions.count(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) > 0;
+    if (m_calibratedTimestampsSupported)
+    {
+        deviceExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+    if (!m_headless)
+    {
+        deviceExtensions.insert(deviceExtensions.end(), c_presentDeviceExtensions.begin(), c_presentDeviceExtensions.end());
+    }
+    m_externalSemaphoreFdSupported = m_shareTimeline && m_timelineSemaphoreSupported &&
+        supportedExtensions.count(VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME) > 0 && SharedTimeline::isSupported(m_physicalDevice);
+    if (m_externalSemaphoreFdSupported)
+    {
+        deviceExtensions.push_back(VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME);
+    }
+    if (m_presentWaitSupported)
+    {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    // Only the feature structs of enabled extensions may be chained
+    void** next = &device12Features.pNext;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    synchronization2Features.synchronization2 = VK_TRUE;
+    if (m_synchronization2Supported)
+    {
+        *next = &synchronization2Features;
+        next = &synchronization2Features.pNext;
+    }
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+    presentIdFeatures.presentId = VK_TRUE;
+    if (m_presentWaitSupported)
+    {
+        *next = &presentIdFeatures;
+    }
+
+    VkDeviceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &device12Features;
+    createInfo.queueCreateInfoCount = ui32Size(queueCreateInfos);
+    createInfo.pQueueCreateInfos = queueCreateInfos.data();
+    createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.enabledExtensionCount = ui32Size(deviceExtensions);
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledLayerCount = ui32Size(c_validationLayers);
+    createInfo.ppEnabledLayerNames = c_validationLayers.data();
+
+    VK_CHECK(vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device));
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily, 0, &m_graphicsQueue);
+    vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily, 0, &m_presentQueue);
+    vkGetDeviceQueue(m_device, m_queueFamilyIndices.computeFamily, computeQueueIndex, &m_computeQueue);
+}
+
+void DeviceContext::createRenderPass()
+{
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = nullptr;
+
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = c_windowSurfaceFormat.format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Offscreen images are left ready for copying out since there is no presentation engine to hand them to
+    colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // Without an acquire semaphore the previous frame's writes to the same offscreen image must be made available
+    dependency.srcAccessMask = m_headless ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    const std::vector<VkAttachmentDescription> attachments{colorAttachment};
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = ui32Size(attachments);
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    VK_CHECK(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass));
+}
+
+// Falls back to FIFO, the only mode every implementation has to support
+void DeviceContext::selectPresentMode(VkPresentModeKHR requested)
+{
+    uint32_t modeCount = 0;
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &modeCount, nullptr));
+    std::vector<VkPresentModeKHR> modes(modeCount);
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &modeCount, modes.data()));
+
+    m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    if (std::find(modes.begin(), modes.end(), requested) != modes.end())
+    {
+        m_presentMode = requested;
+    }
+    else
+    {
+        printf("Present mode %s not supported, using %s\n", presentModeName(requested), presentModeName(m_presentMode));
+    }
+}
+
+void DeviceContext::createSwapchain(VkSwapchainKHR oldSwapchain)
+{
+    VkSurfaceCapabilitiesKHR capabilities;
+    VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &capabilities));
+
+    // The surface size is either fixed by the platform or follows the window's framebuffer
+    m_extent = capabilities.currentExtent;
+    if (m_extent.width == UINT32_MAX)
+    {
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        m_extent.width = std::min(std::max(static_cast<uint32_t>(width), capabilities.minImageExtent.width), capabilities.maxImageExtent.width);
+        m_extent.height = std::min(std::max(static_cast<uint32_t>(height), capabilities.minImageExtent.height), capabilities.maxImageExtent.height);
+    }
+
+    uint32_t imageCount = std::max(c_swapchainImageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount != 0)
+    {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = m_surface;
+    createInfo.minImageCount = imageCount;
+    createInfo.imageFormat = c_windowSurfaceFormat.format;
+    createInfo.imageColorSpace = c_windowSurfaceFormat.colorSpace;
+    createInfo.imageExtent = m_extent;
+    createInfo.imageArrayLayers = 1;
+    CHECK((capabilities.supportedUsageFlags & m_swapchainImageUsage) == m_swapchainImageUsage);
+    createInfo.imageUsage = m_swapchainImageUsage;
+    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.queueFamilyIndexCount = 0;
+    createInfo.pQueueFamilyIndices = nullptr;
+    createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    createInfo.presentMode = m_presentMode;
+    createInfo.clipped = VK_TRUE;
+    // Lets the implementation hand over resources from the old swapchain instead of stalling
+    createInfo.oldSwapchain = oldSwapchain;
+
+    VK_CHECK(vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapchain));
+
+    uint32_t queriedImageCount;
+    vkGetSwapchainImagesKHR(m_device, m_swapchain, &queriedImageCount, nullptr);
+    m_swapchainImages.resize(queriedImageCount);
+    vkGetSwapchainImagesKHR(m_device, m_swapchain, &queriedImageCount, m_swapchainImages.data());
+    m_imagePresentCounts.assign(m_swapchainImages.size(), 0);
+    m_spareImageCount = queriedImageCount - std::min(queriedImageCount, capabilities.minImageCount);
+}
+
+// Headless stand-in for createSwapchain(): a ring of plain images that the rest of the setup treats as
+// swapchain images.
+void DeviceContext::createOffscreenImages()
+{
+    VkImageCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    createInfo.imageType = VK_IMAGE_TYPE_2D;
+    createInfo.format = c_windowSurfaceFormat.format;
+    m_extent = c_windowExtent;
+    createInfo.extent = {m_extent.width, m_extent.height, 1};
+    createInfo.mipLevels = 1;
+    createInfo.arrayLayers = 1;
+    createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    m_swapchainImages.resize(c_swapchainImageCount);
+    m_offscreenImageAllocations.resize(c_swapchainImageCount);
+    for (size_t i = 0; i < c_swapchainImageCount; ++i)
+    {
+        VK_CHECK(vkCreateImage(m_device, &createInfo, nullptr, &m_swapchainImages[i]));
+        m_offscreenImageAllocations[i] = m_memoryArena.bindImage(m_swapchainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+}
+
+void DeviceContext::createSwapchainImageViews()
+{
+    const VkImageSubresourceRange SubresourceRance{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    m_swapchainImageViews.resize(m_swapchainImages.size());
+    for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
+    {
+        VkImageViewCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.image = m_swapchainImages[i];
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        createInfo.format = c_windowSurfaceFormat.format;
+        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.subresourceRange = SubresourceRance;
+
+        VK_CHECK(vkCreateImageView(m_device, &createInfo, nullptr, &m_swapchainImageViews[i]));
+    }
+}
+
+void DeviceContext::createFramebuffers()
+{
+    m_framebuffers.resize(m_swapchainImageViews.size());
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+
+    for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
+    {
+        const std::vector<VkImageView> attachments{m_swapchainImageViews[i]};
+        framebufferInfo.attachmentCount = ui32Size(attachments);
+        framebufferInfo.pAttachments = attachments.data();
+        VK_CHECK(vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_framebuffers[i]));
+    }
+}
+
+void DeviceContext::createCommandPools()
+{
+    // One pool per frame in flight so that a whole frame's allocations can be recycled with a single
+    // vkResetCommandPool once the GPU is done with it.
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_graphicsCommandPools.resize(m_framesInFlight);
+    for (size_t i = 0; i < m_framesInFlight; ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_graphicsCommandPools[i]));
+    }
+}
+
+void DeviceContext::allocateCommandBuffers()
+{
+    m_commandBuffers.resize(m_framesInFlight);
+    for (size_t i = 0; i < m_framesInFlight; ++i)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_graphicsCommandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffers[i]));
+    }
+}
+
+void DeviceContext::createRenderFinishedSemaphores()
+{
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    m_renderFinishedBinarySemaphores.resize(m_swapchainImages.size());
+    for (VkSemaphore& semaphore : m_renderFinishedBinarySemaphores)
+    {
+        VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore));
+    }
+}
+
+void DeviceContext::createSemaphores()
+{
+    if (!m_headless)
+    {
+        // Acquire semaphores are recycled with the frame slot, present semaphores with the swapchain image
+        // because the presentation engine may still hold the latter when the frame slot comes around again.
+        m_imageAvailableBinarySemaphores.resize(m_framesInFlight);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (VkSemaphore& semaphore : m_imageAvailableBinarySemaphores)
+        {
+            VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore));
+        }
+    }
+
+    if (m_timelineSemaphoreSupported)
+    {
+        // Exportable so that --share-timeline can hand it to another process
+        m_frameTimeline.create(m_device, m_framesInFlight, m_externalSemaphoreFdSupported);
+    }
+}
+
+// Destroys the handles retired at runtime whose last submission has completed. Takes the retired present id
+// and count instead of reading the members so that it can run on the completion reactor's thread.
+void DeviceContext::collectDeletions(uint64_t completedValue, uint64_t retiredPresentId, uint64_t retiredPresentCount)
+{
+    // vkWaitForPresentKHR may still be blocked on a retired swapchain, so leave it until the waiter moved on
+    if (m_presentWaiter.isEnabled() && !m_presentWaiter.isProcessed(retiredPresentId))
+    {
+        return;
+    }
+    // The render finished semaphores and the swapchain retired with them may still be used by its presents
+    if (retiredPresentCount > 0 && m_acquiredPresentCount.load() <= retiredPresentCount)
+    {
+        return;
+    }
+    m_deletionQueue.collect(completedValue);
+}
+
+// Replaces the swapchain without waiting for the device, the old objects are destroyed through the deletion
+// queue once the last submission that used them has completed
+void DeviceContext::recreateSwapchain()
+{
+    // Presents still in the ring use the swapchain that is retired here
+    if (m_submitOnThread)
+    {
+        m_submitThread.waitIdle();
+    }
+
+    // A minimized window has a zero sized surface, which can't have a swapchain
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    while (width == 0 || height == 0)
+    {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(m_window, &width, &height);
+    }
+
+    for (const VkSemaphore& semaphore : m_renderFinishedBinarySemaphores)
+    {
+        m_deletionQueue.deferSemaphore(semaphore, m_submitValue);
+    }
+    for (const VkFramebuffer& framebuffer : m_framebuffers)
+    {
+        m_deletionQueue.deferFramebuffer(framebuffer, m_submitValue);
+    }
+    for (const VkImageView& imageView : m_swapchainImageViews)
+    {
+        m_deletionQueue.deferImageView(imageView, m_submitValue);
+    }
+    m_deletionQueue.deferSwapchain(m_swapchain, m_submitValue);
+    m_retiredPresentId = m_presentId;
+    m_retiredPresentCount = m_presentCount;
+
+    const size_t oldImageCount = m_swapchainImages.size();
+    createSwapchain(m_swapchain);
+    createSwapchainImageViews();
+    createFramebuffers();
+    createRenderFinishedSemaphores();
+
+    if (m_commandBufferCache.isEnabled())
+    {
+        if (m_swapchainImages.size() == oldImageCount)
+        {
+            m_commandBufferCache.invalidate();
+        }
+        else
+        {
+            // The cache is sized by the image count, and its command buffers may still be pending
+            m_commandBufferCache.retire(m_deletionQueue, m_submitValue);
+            m_commandBufferCache.create(m_device, m_queueFamilyIndices.graphicsFamily, m_framesInFlight, ui32Size(m_framebuffers));
+        }
+    }
+    m_swapchainDirty = false;
+}
+
+template<bool Headless>
+void DeviceContext::addPresentSemaphores(SubmitBatcher& submits, uint32_t frameIndex, uint32_t imageIndex)
+{
+    if (!Headless)
+    {
+        submits.addWait(m_imageAvailableBinarySemaphores[frameIndex], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+        // Presentation only needs the color writes, not the timestamp at the end of the command buffer
+        submits.addSignal(m_renderFinishedBinarySemaphores[imageIndex], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+    }
+}
+
+void DeviceContext::waitForFence(uint32_t frameIndex)
+{
+    VK_CHECK(vkWaitForFences(m_device, 1, &m_fences[frameIndex], true, c_timeout));
+    VK_CHECK(vkResetFences(m_device, 1, &m_fences[frameIndex]));
+}
+
+// After the frame slot wait, the submission that last used the slot and every one before it have completed
+uint64_t DeviceContext::fencedCompletedValue() const
+{
+    return m_submitValue >= m_framesInFlight ? m_submitValue + 1 - m_framesInFlight : 0;
+}
+
+// Submission value v was made with frame slot (v - 1) % framesInFlight, whose fence signals once it or a later
+// submission of the slot completes. Values above fencedCompletedValue() are never in the current slot, whose
+// fence is reset but not yet submitted.
+void DeviceContext::fencedWaitForValue(uint64_t value)
+{
+    CHECK(value <= m_submitValue);
+    const uint32_t frameIndex = static_cast<uint32_t>((value - 1) % m_framesInFlight);
+    VK_CHECK(vkWaitForFences(m_device, 1, &m_fences[frameIndex], true, c_timeout));
+}
+
+// Per-strategy frame synchronization of a context. waitForFrameSlot() blocks until the submission that last
+// used the frame slot has finished on the GPU, submit() makes the frame's queue submission of the given command
+// buffer and completedValue() returns the m_submitValue up to which submissions are known to have completed and
+// waitForValue() blocks until the given one has.
+// Each specialization is compiled into its own frame loop so that the strategy costs no branches per frame.
+template<>
+struct FrameSync<SyncStrategy::Fence>
+{
+    static void waitForFrameSlot(DeviceContext& context, uint32_t frameIndex)
+    {
+        context.waitForFence(frameIndex);
+    }
+
+    template<bool Headless>
+    static void submit(DeviceContext& context, VkCommandBuffer cb, uint32_t frameIndex, uint32_t imageIndex)
+    {
+        SubmitBatcher& submits = context.m_graphicsSubmits;
+        submits.beginBatch();
+        context.addPresentSemaphores<Headless>(submits, frameIndex, imageIndex);
+        submits.addCommandBuffer(cb);
+        submits.flush(context.m_fences[frameIndex]);
+        ++context.m_submitValue;
+    }
+
+    static uint64_t completedValue(const DeviceContext& context)
+    {
+        return context.fencedCompletedValue();
+    }
+
+    static void waitForValue(DeviceContext& context, uint64_t value)
+    {
+        context.fencedWaitForValue(value);
+    }
+};
+
+template<>
+struct FrameSync<SyncStrategy::Binary>
+{
+    static void waitForFrameSlot(DeviceContext& context, uint32_t frameIndex)
+    {
+        context.waitForFence(frameIndex);
+    }
+
+    // m_frameChainSemaphores are used in turns: the frame waits on the one the previous frame signaled and
+    // signals the other. beginRun() pre-signals the second one so that the first frame needs no special case.
+    template<bool Headless>
+    static void submit(DeviceContext& context, VkCommandBuffer cb, uint32_t frameIndex, uint32_t imageIndex)
+    {
+        SubmitBatcher& submits = context.m_graphicsSubmits;
+        submits.beginBatch();
+        context.addPresentSemaphores<Headless>(submits, frameIndex, imageIndex);
+        submits.addWait(context.m_frameChainSemaphores[context.m_chainIndex ^ 1], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR);
+        submits.addCommandBuffer(cb);
+        submits.addSignal(context.m_frameChainSemaphores[context.m_chainIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR);
+        submits.flush(context.m_fences[frameIndex]);
+        context.m_chainIndex ^= 1;
+        ++context.m_submitValue;
+    }
+
+    static uint64_t completedValue(const DeviceContext& context)
+    {
+        return context.fencedCompletedValue();
+    }
+
+    static void waitForValue(DeviceContext& context, uint64_t value)
+    {
+        context.fencedWaitForValue(value);
+    }
+
+    static void beginRun(DeviceContext& context)
+    {
+        context.m_chainIndex = 0;
+        context.m_graphicsSubmits.beginBatch();
+        context.m_graphicsSubmits.addSignal(context.m_frameChainSemaphores[1], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR);
+        context.m_graphicsSubmits.flush();
+    }
+};
+
+template<>
+struct FrameSync<SyncStrategy::Timeline>
+{
+    // Every submit signals the next value of a single device-wide timeline, so frame slot reuse is a wait for
+    // value - framesInFlight instead of a fence per slot.
+    static void waitForFrameSlot(DeviceContext& context, uint32_t frameIndex)
+    {
+        if (context.m_asyncCompute.isEnabled())
+        {
+            context.m_asyncCompute.waitForFrameSlot(frameIndex);
+        }
+        context.m_frameTimeline.waitForFrameSlot();
+    }
+
+    template<bool Headless>
+    static void submit(DeviceContext& context, VkCommandBuffer cb, uint32_t frameIndex, uint32_t imageIndex)
+    {
+        SubmitBatcher& submits = context.m_graphicsSubmits;
+        FrameTimeline& timeline = context.m_frameTimeline;
+        AsyncCompute& asyncCompute = context.m_asyncCompute;
+        if (asyncCompute.isEnabled())
+        {
+            asyncCompute.submitFrame(context.m_computeSubmits, frameIndex, timeline.semaphore(), timeline.value());
+            context.m_computeSubmits.flush();
+        }
+        if (context.m_hostProducer.isEnabled())
+        {
+            // Batched ahead of the frame so that the frame's timeline value also covers the copy
+            context.m_hostProducer.submitFrame(submits, frameIndex);
+        }
+
+        if (context.m_submitOnThread)
+        {
+            // Async compute and host producers are ruled out by the options, the frame is a single batch
+            SubmitThread::Packet packet{};
+            packet.commandBuffer = cb;
+            packet.signalValue = timeline.nextValue();
+            if (!Headless)
+            {
+                packet.imageAvailableSemaphore = context.m_imageAvailableBinarySemaphores[frameIndex];
+                packet.renderFinishedSemaphore = context.m_renderFinishedBinarySemaphores[imageIndex];
+                packet.swapchain = context.m_swapchain;
+                packet.imageIndex = imageIndex;
+                packet.presentId = context.m_presentWaiter.isEnabled() ? ++context.m_presentId : 0;
+                packet.submitNanoseconds = hostNanoseconds();
+            }
+            context.m_submitThread.enqueue(packet);
+            context.m_submitValue = packet.signalValue;
+            return;
+        }
+
+        submits.beginBatch();
+        context.addPresentSemaphores<Headless>(submits, frameIndex, imageIndex);
+        if (asyncCompute.isEnabled())
+        {
+            // Cross-queue dependency expressed purely as a timeline value, the compute result is copied first
+            submits.addWait(asyncCompute.semaphore(), VK_PIPELINE_STAGE_2_COPY_BIT_KHR, asyncCompute.graphicsWaitValue());
+            const VkCommandBuffer computeResultCb = asyncCompute.recordGraphicsFrame(frameIndex);
+            if (computeResultCb != VK_NULL_HANDLE)
+            {
+                submits.addCommandBuffer(computeResultCb);
+            }
+        }
+        submits.addCommandBuffer(cb);
+        // All commands, the frame slot's command pool and queries are reused once this value is reached
+        const uint64_t signalValue = timeline.nextValue();
+        submits.addSignal(timeline.semaphore(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, signalValue);
+        submits.flush();
+        context.m_submitValue = signalValue;
+    }
+
+    // Doesn't block, so deferred handles are freed as soon as the GPU is past them rather than per frame slot
+    static uint64_t completedValue(const DeviceContext& context)
+    {
+        return context.m_frameTimeline.completedValue();
+    }
+
+    static void waitForValue(DeviceContext& context, uint64_t value)
+    {
+        context.m_frameTimeline.waitForValue(value);
+    }
+};
+
+bool DeviceContext::isSyncStrategySupported(SyncStrategy strategy) const
+{
+    return strategy != SyncStrategy::Timeline || m_timelineSemaphoreSupported;
+}
+
+// Fences and chain semaphores are recreated for every run so that each one starts from a known state
+void DeviceContext::createSyncObjects(SyncStrategy strategy)
+{
+    m_submitValue = strategy == SyncStrategy::Timeline ? m_frameTimeline.value() : 0;
+
+    if (strategy == SyncStrategy::Fence || strategy == SyncStrategy::Binary)
+    {
+        VkFenceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        m_fences.resize(m_framesInFlight);
+        for (VkFence& fence : m_fences)
+        {
+            VK_CHECK(vkCreateFence(m_device, &createInfo, nullptr, &fence));
+        }
+    }
+
+    if (strategy == SyncStrategy::Binary)
+    {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (VkSemaphore& semaphore : m_frameChainSemaphores)
+        {
+            VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore));
+        }
+        FrameSync<SyncStrategy::Binary>::beginRun(*this);
+    }
+}
+
+void DeviceContext::destroySyncObjects()
+{
+    for (const VkFence& fence : m_fences)
+    {
+        vkDestroyFence(m_device, fence, nullptr);
+    }
+    m_fences.clear();
+
+    for (VkSemaphore& semaphore : m_frameChainSemaphores)
+    {
+        if (semaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_device, semaphore, nullptr);
+            semaphore = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void DeviceContext::collectGpuTime(uint32_t frameIndex)
+{
+    GpuInterval graphics;
+    const bool hasGraphics = m_gpuTimestamps.collect(frameIndex, graphics);
+    if (hasGraphics)
+    {
+        m_frameStats.phase(FramePhase::Gpu).add(graphics.end - graphics.begin);
+        m_trace->gpuSpan("graphics", "frame", graphics.begin, graphics.end);
+        m_trace->boundGpuClock(m_submitNanoseconds[frameIndex], graphics.begin);
+        m_framePacer.addGpuTime(graphics.end - graphics.begin);
+        if (m_gpuTimestamps.isCalibrated())
+        {
+            const uint64_t end = m_gpuTimestamps.toHostNanoseconds(graphics.end);
+            const uint64_t start = m_frameStartNanoseconds[frameIndex];
+            m_frameStats.phase(FramePhase::Latency).add(end > start ? end - start : 0);
+        }
+    }
+
+    GpuInterval compute;
+    if (m_asyncCompute.isEnabled() && m_asyncCompute.collectGpuInterval(frameIndex, compute))
+    {
+        m_frameStats.phase(FramePhase::ComputeGpu).add(compute.end - compute.begin);
+        m_trace->gpuSpan("compute", "async compute", compute.begin, compute.end);
+        if (hasGraphics)
+        {
+            const uint64_t overlapBegin = std::max(graphics.begin, compute.begin);
+            const uint64_t overlapEnd = std::min(graphics.end, compute.end);
+            m_frameStats.phase(FramePhase::Overlap).add(overlapEnd > overlapBegin ? overlapEnd - overlapBegin : 0);
+        }
+    }
+
+    if (m_hostProducer.isEnabled())
+    {
+        m_hostProducer.collectStats(frameIndex, m_frameStats);
+    }
+}
+
+template<bool Headless>
+uint32_t DeviceContext::acquireImage(uint32_t frameIndex, uint64_t frameNumber)
+{
+    if (Headless)
+    {
+        // Offscreen images are used round-robin; reuse is ordered by the render pass dependency
+        return static_cast<uint32_t>(frameNumber % m_swapchainImages.size());
+    }
+
+    uint32_t imageIndex;
+    for (;;)
+    {
+        VkResult result;
+        if (m_submitOnThread)
+        {
+            // The submit thread presents to the swapchain under the lock, so the acquire must not block on an
+            // image that only one of the presents still in the ring would release. Every packet holds an
+            // acquired image, and with no more than the spare images held the acquire is guaranteed to return.
+            m_submitThread.waitForPending(m_spareImageCount);
+            std::lock_guard<std::mutex> lock(m_submitThread.swapchainMutex());
+            result = vkAcquireNextImageKHR(m_device, m_swapchain, c_timeout, m_imageAvailableBinarySemaphores[frameIndex], VK_NULL_HANDLE, &imageIndex);
+        }
+        else
+        {
+            result = vkAcquireNextImageKHR(m_device, m_swapchain, c_timeout, m_imageAvailableBinarySemaphores[frameIndex], VK_NULL_HANDLE, &imageIndex);
+        }
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            // Nothing was acquired, so the semaphore is still unsignaled and can be used with the new swapchain
+            recreateSwapchain();
+            continue;
+        }
+        if (result == VK_SUBOPTIMAL_KHR)
+        {
+            // The image is acquired and its semaphore will be signaled, so render this frame and recreate after present
+            m_swapchainDirty = true;
+        }
+        else
+        {
+            VK_CHECK(result);
+        }
+        if (m_imagePresentCounts[imageIndex] > m_acquiredPresentCount.load())
+        {
+            m_acquiredPresentCount.store(m_imagePresentCounts[imageIndex]);
+        }
+        return imageIndex;
+    }
+}
+
+void DeviceContext::recordRenderPass(VkCommandBuffer cb, uint32_t frameIndex, uint32_t imageIndex, VkCommandBufferUsageFlags usage)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = usage;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    const bool parallel = m_parallelRecorder.isEnabled();
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = c_clearColor;
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_framebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_extent;
+    renderPassInfo.clearValueCount = ui32Size(clearValues);
+    renderPassInfo.pClearValues = clearValues.data();
+
+    m_gpuTimestamps.cmdBegin(cb, frameIndex);
+    if (m_uploadRing.isEnabled())
+    {
+        // Every strategy's next submission signals the value after the current one
+        m_uploadRing.cmdCopy(cb, m_submitValue + 1);
+    }
+    if (m_gpuWorkload.isEnabled())
+    {
+        m_gpuWorkload.cmdDispatch(cb);
+    }
+    vkCmdBeginRenderPass(cb, &renderPassInfo, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    if (parallel)
+    {
+        m_parallelRecorder.cmdExecute(cb, frameIndex);
+    }
+    else if (m_gpuWorkload.isEnabled())
+    {
+        m_gpuWorkload.cmdDraw(cb, m_extent);
+    }
+    vkCmdEndRenderPass(cb);
+    if (m_readbackOnRun)
+    {
+        m_frameReadback.cmdCopy(cb, m_swapchainImages[imageIndex], m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, m_extent);
+    }
+    m_gpuTimestamps.cmdEnd(cb, frameIndex);
+
+    VK_CHECK(vkEndCommandBuffer(cb));
+}
+
+// Returns the command buffer to submit for the frame
+VkCommandBuffer DeviceContext::recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex)
+{
+    if (m_recordMode == RecordMode::Cache)
+    {
+        CommandBufferCache::Key key;
+        key.framebuffer = m_framebuffers[imageIndex];
+        key.clearColor = c_clearColor;
+
+        VkCommandBuffer cb;
+        if (m_commandBufferCache.acquire(frameIndex, imageIndex, key, cb))
+        {
+            // The cached command buffer resets and writes the slot's timestamp queries itself
+            m_gpuTimestamps.markPending(frameIndex);
+        }
+        else
+        {
+            recordRenderPass(cb, frameIndex, imageIndex, 0);
+        }
+        return cb;
+    }
+
+    // Workers record the render pass contents while the primary command buffer is being set up
+    if (m_parallelRecorder.isEnabled())
+    {
+        m_parallelRecorder.beginFrame(frameIndex, m_framebuffers[imageIndex], m_extent);
+    }
+
+    VkCommandBuffer cb = m_commandBuffers[frameIndex];
+    const VkCommandPoolResetFlags resetFlags = m_recordMode == RecordMode::Release ? VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT : 0;
+    VK_CHECK(vkResetCommandPool(m_device, m_graphicsCommandPools[frameIndex], resetFlags));
+    recordRenderPass(cb, frameIndex, imageIndex, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    return cb;
+}
+
+template<bool Headless>
+void DeviceContext::presentImage(uint32_t imageIndex, uint64_t submitNanoseconds)
+{
+    if (Headless)
+    {
+        return;
+    }
+
+    m_imagePresentCounts[imageIndex] = ++m_presentCount;
+    if (m_submitOnThread)
+    {
+        // Presented by the submit thread, which only reports back that the swapchain needs replacing
+        if (m_submitThread.takeSwapchainDirty())
+        {
+            m_swapchainDirty = true;
+        }
+        if (m_swapchainDirty)
+        {
+            recreateSwapchain();
+        }
+        return;
+    }
+
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &m_presentId;
+
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.pNext = m_presentWaiter.isEnabled() ? &presentId : nullptr;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &m_renderFinishedBinarySemaphores[imageIndex];
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &m_swapchain;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.pResults = nullptr;
+
+    if (m_presentWaiter.isEnabled())
+    {
+        ++m_presentId;
+        m_presentWaiter.add(m_swapchain, m_presentId, submitNanoseconds);
+    }
+
+    const VkResult result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        m_swapchainDirty = true;
+    }
+    else
+    {
+        VK_CHECK(result);
+    }
+
+    // Set by the resize callback as well, which may fire without the present reporting anything
+    if (m_swapchainDirty)
+    {
+        recreateSwapchain();
+    }
+}
+
+// Writes the frame's uploads into the staging ring, waiting for older frames' copies when it is full
+template<typename Sync>
+void DeviceContext::stageUploads()
+{
+    m_uploadRing.reclaim(Sync::completedValue(*this));
+    for (VkDeviceSize offset = 0; offset < m_uploadBytesPerFrame; offset += c_uploadChunkSize)
+    {
+        const VkDeviceSize size = std::min(c_uploadChunkSize, m_uploadBytesPerFrame - offset);
+        UploadRing::Region region;
+        while (!m_uploadRing.allocate(size, region))
+        {
+            const uint64_t value = m_uploadRing.oldestPendingValue();
+            Sync::waitForValue(*this, value);
+            m_uploadRing.reclaim(value);
+        }
+        memcpy(region.data, &m_uploadSource[offset], size);
+        m_uploadRing.copy(region, offset);
+    }
+}
+
+template<bool Headless>
+bool DeviceContext::shouldQuit(uint64_t frameNumber, double elapsedSeconds, const Options& options) const
+{
+    if (options.frameCount != 0 && frameNumber >= options.frameCount)
+    {
+        return true;
+    }
+    if (options.durationSeconds != 0.0 && elapsedSeconds >= options.durationSeconds)
+    {
+        return true;
+    }
+    return !Headless && glfwWindowShouldClose(m_window);
+}
+
+// Samples the completed values, which with the fence based strategies count submissions rather than being a
+// semaphore's value
+template<typename Sync>
+void DeviceContext::traceCompletedValues()
+{
+    const uint64_t now = hostNanoseconds();
+    m_trace->counter("frame completed", now, Sync::completedValue(*this));
+    if (m_asyncCompute.isEnabled())
+    {
+        uint64_t value = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_asyncCompute.semaphore(), &value));
+        m_trace->counter("compute completed", now, value);
+    }
+}
+
+void DeviceContext::traceSubmittedValues(uint64_t submitNanoseconds)
+{
+    m_trace->counter("frame submitted", submitNanoseconds, m_submitValue);
+    if (m_asyncCompute.isEnabled())
+    {
+        m_trace->counter("compute submitted", submitNanoseconds, m_asyncCompute.value());
+    }
+}
+
+// Keeps at most one submission queued and sleeps until the frame can start just in time, see FramePacer
+template<typename Sync>
+void DeviceContext::paceFrame()
+{
+    if (m_submitValue == 0)
+    {
+        return;
+    }
+
+    // Completion of the second to last submission is only observed when it has to be waited for. If it had
+    // already completed, the last submission is assumed to have started when it was made.
+    uint64_t previousCompletion = 0;
+    if (m_submitValue >= 2 && Sync::completedValue(*this) < m_submitValue - 1)
+    {
+        Sync::waitForValue(*this, m_submitValue - 1);
+        previousCompletion = hostNanoseconds();
+    }
+
+    const uint64_t start = m_framePacer.nextFrameStart(previousCompletion, m_lastSubmitNanoseconds);
+    const uint64_t now = hostNanoseconds();
+    if (start > now)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(start - now));
+    }
+}
+
+template<SyncStrategy Strategy, bool Headless>
+DeviceContext::RunResult DeviceContext::runFrameLoop(const Options& options)
+{
+    typedef FrameSync<Strategy> Sync;
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point startTime = Clock::now();
+    double elapsedSeconds = 0.0;
+
+    uint64_t frameNumber = 0;
+    uint32_t frameIndex = 0;
+    while (!shouldQuit<Headless>(frameNumber, elapsedSeconds, options))
+    {
+        PhaseTimer frameTimer(m_frameStats, *m_trace, FramePhase::Frame);
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Wait);
+            Sync::waitForFrameSlot(*this, frameIndex);
+        }
+        // The frame slot's previous submission has completed, so its transient memory can be reused
+        m_memoryArena.resetFrame(frameIndex);
+        if (m_trace->isEnabled())
+        {
+            traceCompletedValues<Sync>();
+        }
+        collectGpuTime(frameIndex);
+        if (m_pacing)
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Pace);
+            paceFrame<Sync>();
+        }
+        const uint64_t frameStartNanoseconds = hostNanoseconds();
+        m_frameStartNanoseconds[frameIndex] = frameStartNanoseconds;
+        const bool reactorCollects = Strategy == SyncStrategy::Timeline && m_completionReactor.isEnabled();
+        if (!reactorCollects && !m_deletionQueue.empty())
+        {
+            collectDeletions(Sync::completedValue(*this), m_retiredPresentId, m_retiredPresentCount);
+        }
+
+        uint32_t imageIndex;
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Acquire);
+            imageIndex = acquireImage<Headless>(frameIndex, frameNumber);
+        }
+        if (m_uploadRing.isEnabled())
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Upload);
+            stageUploads<Sync>();
+        }
+        VkCommandBuffer cb;
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Record);
+            cb = recordCommandBuffer(frameIndex, imageIndex);
+        }
+        const uint64_t submitNanoseconds = hostNanoseconds();
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Submit);
+            Sync::template submit<Headless>(*this, cb, frameIndex, imageIndex);
+        }
+        m_submitNanoseconds[frameIndex] = submitNanoseconds;
+        m_lastSubmitNanoseconds = submitNanoseconds;
+        m_framePacer.addCpuTime(submitNanoseconds - frameStartNanoseconds);
+        if (m_readbackOnRun)
+        {
+            m_frameReadback.submitted(m_frameTimeline.semaphore(), m_submitValue);
+        }
+        if (reactorCollects && !m_deletionQueue.empty())
+        {
+            const uint64_t retiredPresentId = m_retiredPresentId;
+            const uint64_t retiredPresentCount = m_retiredPresentCount;
+            m_completionReactor.onValue(m_frameTimeline.semaphore(),
+                                        m_submitValue,
+                                        [this, retiredPresentId, retiredPresentCount](uint64_t completedValue) {
+                                            collectDeletions(completedValue, retiredPresentId, retiredPresentCount);
+                                        });
+        }
+        if (m_trace->isEnabled())
+        {
+            traceSubmittedValues(submitNanoseconds);
+        }
+        ++frameNumber;
+        {
+            PhaseTimer timer(m_frameStats, *m_trace, FramePhase::Present);
+            presentImage<Headless>(imageIndex, submitNanoseconds);
+        }
+        if (frameNumber == 1)
+        {
+            m_startupProfiler->finish("first frame");
+        }
+
+        if (!Headless)
+        {
+            glfwPollEvents();
+        }
+
+        ++frameIndex;
+        if (frameIndex == m_framesInFlight)
+        {
+            frameIndex = 0;
+        }
+        elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    }
+
+    // Include the frames still in flight so the rate reflects completed GPU work
+    if (m_submitOnThread)
+    {
+        m_submitThread.waitIdle();
+    }
+    VK_CHECK(vkDeviceWaitIdle(m_device));
+    if (m_presentWaiter.isEnabled())
+    {
+        m_presentWaiter.waitProcessed(m_retiredPresentId);
+    }
+    // Without the acquire that would show it, the device being idle has to cover the retired presents' waits
+    m_deletionQueue.collect(UINT64_MAX);
+    m_uploadRing.reclaim(UINT64_MAX);
+
+    RunResult result;
+    result.frameCount = frameNumber;
+    result.seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    return result;
+}
+
+template<bool Headless>
+DeviceContext::FrameLoop DeviceContext::selectFrameLoop(SyncStrategy strategy)
+{
+    switch (strategy)
+    {
+    case SyncStrategy::Fence:
+        return &DeviceContext::runFrameLoop<SyncStrategy::Fence, Headless>;
+    case SyncStrategy::Binary:
+        return &DeviceContext::runFrameLoop<SyncStrategy::Binary, Headless>;
+    case SyncStrategy::Timeline:
+        return &DeviceContext::runFrameLoop<SyncStrategy::Timeline, Headless>;
+    default:
+        CHECK(!"Unknown sync strategy");
+        return nullptr;
+    }
+}
+
+DeviceContext::RunResult DeviceContext::run(SyncStrategy strategy, bool paced, const Options& options)
+{
+    m_pacing = paced;
+    m_framePacer.reset();
+    m_frameStats = FrameStats();
+    m_commandBufferCache.resetCounters();
+    m_uploadRing.resetCounters();
+    m_submitOnThread = m_submitThread.isEnabled() && strategy == SyncStrategy::Timeline;
+    m_readbackOnRun = m_frameReadback.isEnabled() && strategy == SyncStrategy::Timeline;
+    if (m_frameReadback.isEnabled())
+    {
+        m_frameReadback.resetCounters();
+    }
+    if (m_submitThread.isEnabled())
+    {
+        m_submitThread.resetCounters();
+    }
+    createSyncObjects(strategy);
+
+    const FrameLoop frameLoop = m_headless ? selectFrameLoop<true>(strategy) : selectFrameLoop<false>(strategy);
+    const RunResult result = (this->*frameLoop)(options);
+
+    for (uint32_t i = 0; i < m_framesInFlight; ++i)
+    {
+        collectGpuTime(i);
+    }
+    if (m_presentWaiter.isEnabled())
+    {
+        m_presentWaiter.waitProcessed(m_presentId);
+        m_presentWaiter.collect(m_frameStats.phase(FramePhase::Display));
+    }
+    if (m_submitOnThread)
+    {
+        m_submitThread.collect(m_frameStats.phase(FramePhase::QueueSubmit), m_frameStats.phase(FramePhase::QueuePresent));
+    }
+    m_readbackLatency.reset();
+    if (m_readbackOnRun)
+    {
+        m_frameReadback.waitIdle();
+        m_frameReadback.collect(m_readbackLatency);
+    }
+    destroySyncObjects();
+    return result;
+}
+
+void DeviceContext::printRunStats(SyncStrategy strategy, bool paced, const RunResult& result) const
+{
+
+    printf("%s%s: %llu frames in %.3f s, %.1f frames/s\n",
+           syncStrategyName(strategy),
+           paced ? ", paced" : "",
+           static_cast<unsigned long long>(result.frameCount),
+           result.seconds,
+           result.seconds > 0.0 ? result.frameCount / result.seconds : 0.0);
+    if (m_commandBufferCache.isEnabled())
+    {
+        printf("Command buffer cache: %llu hits, %llu misses\n",
+               static_cast<unsigned long long>(m_commandBufferCache.hits()),
+               static_cast<unsigned long long>(m_commandBufferCache.misses()));
+    }
+    if (m_uploadRing.isEnabled())
+    {
+        printf("Uploads: %.1f MB/s, %llu stalls on a full ring\n",
+               result.seconds > 0.0 ? m_uploadRing.bytesCopied() / result.seconds / (1024.0 * 1024.0) : 0.0,
+               static_cast<unsigned long long>(m_uploadRing.stalls()));
+    }
+    if (m_submitOnThread)
+    {
+        // qsubmit and qpresent below are what the frame loop no longer spends in submit and present
+        printf("Submit thread: %.2f frames queued ahead on average, %u at most, %llu stalls on a full ring\n",
+               m_submitThread.meanDepth(),
+               m_submitThread.maxDepth(),
+               static_cast<unsigned long long>(m_submitThread.stalls()));
+    }
+    if (m_readbackOnRun)
+    {
+        printf("Readback: %llu frames, %llu skipped on a full ring, %.2f ms from submit to consumed, last checksum %016llx\n",
+               static_cast<unsigned long long>(m_frameReadback.framesRead()),
+               static_cast<unsigned long long>(m_frameReadback.framesSkipped()),
+               m_readbackLatency.mean() / 1000000.0,
+               static_cast<unsigned long long>(m_frameReadback.lastChecksum()));
+    }
+    if (paced)
+    {
+        printf("Pacing: %.1f us GPU and %.1f us CPU per frame estimated\n",
+               m_framePacer.gpuEstimate() / 1000.0,
+               m_framePacer.cpuEstimate() / 1000.0);
+    }
+    m_frameStats.print();
+}
+
+// Everything that needs the device but not the swapchain, so it can be created on another thread while the
+// swapchain is created on the calling thread
+void DeviceContext::createFrameResources(const Options& options)
+{
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "command buffers");
+        createCommandPools();
+        allocateCommandBuffers();
+    }
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "semaphores");
+        createSemaphores();
+    }
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "timestamp queries");
+        m_deletionQueue.create(m_device);
+        m_gpuTimestamps.create(m_device, m_physicalDevice, m_queueFamilyIndices.graphicsFamily, m_framesInFlight);
+    }
+    if (options.gpuDispatches > 0 || options.gpuDraws > 0)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "gpu workload pipelines");
+        GpuWorkload::Settings settings;
+        settings.dispatchCount = options.gpuDispatches;
+        settings.drawCount = options.gpuDraws;
+        settings.iterations = options.gpuIterations;
+        settings.resolution = options.gpuResolution;
+        m_gpuWorkload.create(m_device, m_memoryArena, m_graphicsQueue, m_queueFamilyIndices.graphicsFamily, m_renderPass, settings);
+    }
+}
+
+void DeviceContext::createSwapchainResources(const Options& options)
+{
+    StartupProfiler::Scope scope(*m_startupProfiler, m_headless ? "offscreen images" : "swapchain");
+    if (m_headless)
+    {
+        createOffscreenImages();
+    }
+    else
+    {
+        selectPresentMode(options.presentMode);
+        createSwapchain(VK_NULL_HANDLE);
+    }
+    createSwapchainImageViews();
+    createFramebuffers();
+    if (!m_headless)
+    {
+        createRenderFinishedSemaphores();
+    }
+}
+
+void DeviceContext::create(VkInstance instance,
+                           VkPhysicalDevice physicalDevice,
+                           GLFWwindow* window,
+                           VkSurfaceKHR surface,
+                           const Options& options,
+                           TraceRecorder& trace,
+                           StartupProfiler& startupProfiler)
+{
+    m_instance = instance;
+    m_physicalDevice = physicalDevice;
+    m_window = window;
+    m_surface = surface;
+    m_headless = options.headless;
+    m_framesInFlight = options.framesInFlight;
+    m_recordMode = options.recordMode;
+    m_shareTimeline = !options.shareTimeline.empty();
+    if (options.readbackSlots > 0)
+    {
+        m_swapchainImageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    m_submitNanoseconds.assign(m_framesInFlight, 0);
+    m_frameStartNanoseconds.assign(m_framesInFlight, 0);
+    m_trace = &trace;
+    m_startupProfiler = &startupProfiler;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+    m_deviceName = properties.deviceName;
+
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "device");
+        queryFeatures();
+        getQueueFamilies();
+        createDevice();
+        createRenderPass();
+        m_memoryArena.create(m_device, m_physicalDevice, m_framesInFlight);
+    }
+    {
+        std::thread frameResourcesThread(&DeviceContext::createFrameResources, this, std::cref(options));
+        createSwapchainResources(options);
+        frameResourcesThread.join();
+    }
+    if (!m_calibratedTimestampsSupported || !m_gpuTimestamps.calibrate(m_instance, m_physicalDevice))
+    {
+        printf("GPU timestamps can not be calibrated against the host clock, frame latency is not measured\n");
+    }
+    if (m_trace->isEnabled())
+    {
+        if (m_gpuTimestamps.isCalibrated())
+        {
+            m_trace->calibrateGpuClock(m_gpuTimestamps.hostOffset());
+        }
+        printf("Tracing to %s\n", options.tracePath.c_str());
+    }
+    const bool synchronization2 = m_synchronization2Supported && !options.legacySubmit;
+    m_graphicsSubmits.create(m_device, m_graphicsQueue, synchronization2, m_timelineSemaphoreSupported);
+    m_computeSubmits.create(m_device, m_computeQueue, synchronization2, m_timelineSemaphoreSupported);
+    printf("Queue submission: %s\n", m_graphicsSubmits.usesSynchronization2() ? "vkQueueSubmit2" : "vkQueueSubmit");
+    if (!m_headless)
+    {
+        if (m_presentWaitSupported)
+        {
+            StartupProfiler::Scope scope(*m_startupProfiler, "present waiter");
+            m_presentWaiter.create(m_device, *m_trace);
+        }
+        printf("Present mode: %s%s\n", presentModeName(m_presentMode), m_presentWaitSupported ? ", measuring present latency" : "");
+    }
+    if (options.submitThread && m_timelineSemaphoreSupported)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "submit thread");
+        m_submitThread.create(m_device, m_graphicsQueue, m_presentQueue, m_frameTimeline.semaphore(), synchronization2, m_presentWaiter, *m_trace);
+    }
+    if (options.readbackSlots > 0 && m_timelineSemaphoreSupported)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "readback");
+        m_frameReadback.create(m_device, m_physicalDevice, m_memoryArena, m_extent, options.readbackSlots, options.capturePath, *m_trace);
+        printf("Readback: %u slots%s%s\n",
+               options.readbackSlots,
+               options.capturePath.empty() ? "" : ", capturing to ",
+               options.capturePath.c_str());
+    }
+    if (options.completionReactor && m_timelineSemaphoreSupported)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "completion reactor");
+        m_completionReactor.create(m_device);
+    }
+    if (options.asyncCompute && m_timelineSemaphoreSupported)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "async compute");
+        m_asyncCompute.create(m_device,
+                              m_physicalDevice,
+                              m_memoryArena,
+                              m_queueFamilyIndices.computeFamily,
+                              m_queueFamilyIndices.graphicsFamily,
+                              options.asyncComputeDepth,
+                              m_framesInFlight);
+        printf("Async compute on queue family %d, overlap depth %u\n", m_queueFamilyIndices.computeFamily, options.asyncComputeDepth);
+    }
+    if (options.hostProducerThreads > 0 && m_timelineSemaphoreSupported)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "host producer");
+        m_hostProducer.create(m_instance,
+                              m_device,
+                              m_physicalDevice,
+                              m_memoryArena,
+                              m_queueFamilyIndices.graphicsFamily,
+                              options.hostProducerThreads,
+                              m_framesInFlight,
+                              m_calibratedTimestampsSupported,
+                              *m_trace);
+        printf("Host producer threads: %u\n", options.hostProducerThreads);
+    }
+    if (options.recordThreads > 0)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "record threads");
+        m_parallelRecorder.create(m_device,
+                                  m_queueFamilyIndices.graphicsFamily,
+                                  m_renderPass,
+                                  options.recordThreads,
+                                  m_framesInFlight,
+                                  options.clearsPerRecordThread);
+        printf("Record threads: %u, %u clears each\n", options.recordThreads, options.clearsPerRecordThread);
+    }
+    if (m_recordMode == RecordMode::Cache)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "command buffer cache");
+        m_commandBufferCache.create(m_device, m_queueFamilyIndices.graphicsFamily, m_framesInFlight, ui32Size(m_framebuffers));
+    }
+    if (m_gpuWorkload.isEnabled())
+    {
+        printf("GPU workload: %u dispatches of %ux%u, %u full-screen draws, %u iterations\n",
+               options.gpuDispatches,
+               options.gpuResolution.width,
+               options.gpuResolution.height,
+               options.gpuDraws,
+               options.gpuIterations);
+    }
+    if (options.uploadMegabytes > 0)
+    {
+        StartupProfiler::Scope scope(*m_startupProfiler, "upload ring");
+        m_uploadBytesPerFrame = static_cast<VkDeviceSize>(options.uploadMegabytes) * 1024 * 1024;
+        m_uploadSource.assign(m_uploadBytesPerFrame, 0x5a);
+        // Room for every frame in flight plus one, so that the ring only fills when the GPU falls behind
+        const uint32_t chunkCount = static_cast<uint32_t>((m_uploadBytesPerFrame + c_uploadChunkSize - 1) / c_uploadChunkSize);
+        m_uploadRing.create(m_device, m_memoryArena, m_uploadBytesPerFrame * (m_framesInFlight + 1), m_uploadBytesPerFrame, chunkCount);
+        printf("Upload ring: %u MB per frame\n", options.uploadMegabytes);
+    }
+    printf("Command buffers: %s\n", recordModeName(m_recordMode));
+    printf("Frames in flight: %u%s\n", m_framesInFlight, m_headless ? ", headless" : "");
+}
+
+void DeviceContext::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    m_submitThread.destroy();
+    vkDeviceWaitIdle(m_device);
+    m_frameReadback.destroy();
+    m_completionReactor.destroy();
+    m_presentWaiter.destroy();
+    m_deletionQueue.destroy();
+    m_gpuTimestamps.destroy();
+    m_asyncCompute.destroy();
+    m_hostProducer.destroy();
+    m_parallelRecorder.destroy();
+    m_commandBufferCache.destroy();
+    m_uploadRing.destroy();
+    m_gpuWorkload.destroy();
+    destroySyncObjects();
+    for (const VkSemaphore& semaphore : m_imageAvailableBinarySemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    m_frameTimeline.destroy();
+    for (const VkCommandPool& commandPool : m_graphicsCommandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+
+    for (const VkSemaphore& semaphore : m_renderFinishedBinarySemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+
+    for (const VkFramebuffer& framebuffer : m_framebuffers)
+    {
+        vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+    }
+
+    for (const VkImageView& imageView : m_swapchainImageViews)
+    {
+        vkDestroyImageView(m_device, imageView, nullptr);
+    }
+
+    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+
+    if (m_headless)
+    {
+        for (size_t i = 0; i < m_swapchainImages.size(); ++i)
+        {
+            vkDestroyImage(m_device, m_swapchainImages[i], nullptr);
+            m_memoryArena.free(m_offscreenImageAllocations[i]);
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+    }
+    m_memoryArena.destroy();
+
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "AsyncCompute.hpp"
+#include "CommandBufferCache.hpp"
+#include "CompletionReactor.hpp"
+#include "DeletionQueue.hpp"
+#include "FramePacer.hpp"
+#include "FrameReadback.hpp"
+#include "FrameTimeline.hpp"
+#include "GpuWorkload.hpp"
+#include "HostProducer.hpp"
+#include "MemoryArena.hpp"
+#include "Options.hpp"
+#include "ParallelRecorder.hpp"
+#include "PresentWaiter.hpp"
+#include "StartupProfiler.hpp"
+#include "SubmitBatcher.hpp"
+#include "SubmitThread.hpp"
+#include "Timing.hpp"
+#include "Trace.hpp"
+#include "UploadRing.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
+
+// Per-strategy frame synchronization, defined in DeviceContext.cpp
+template<SyncStrategy Strategy>
+struct FrameSync;
+
+// Everything one device needs to run the frame loop: the device and its queues, the swapchain or offscreen
+// images, command pools, sync objects, the frame timeline and the optional features. The instance, window and
+// surface belong to the caller. Contexts of different devices share nothing, so several can run their frame
+// loops concurrently, each on its own thread.
+class DeviceContext
+{
+public:
+    struct RunResult
+    {
+        uint64_t frameCount = 0;
+        double seconds = 0.0;
+    };
+
+    // Size of the window and of the offscreen images in headless mode
+    static const VkExtent2D c_windowExtent;
+
+    // The window and surface are null in headless mode. The trace and profiler must outlive the context.
+    void create(VkInstance instance,
+                VkPhysicalDevice physicalDevice,
+                GLFWwindow* window,
+                VkSurfaceKHR surface,
+                const Options& options,
+                TraceRecorder& trace,
+                StartupProfiler& startupProfiler);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+    bool isSyncStrategySupported(SyncStrategy strategy) const;
+
+    // Runs the frame loop on the calling thread until the options or the window say to stop, and waits for the
+    // device to be idle
+    RunResult run(SyncStrategy strategy, bool paced, const Options& options);
+    // Prints what the features measured during the last run and its frame stats
+    void printRunStats(SyncStrategy strategy, bool paced, const RunResult& result) const;
+    const FrameStats& frameStats() const { return m_frameStats; }
+
+    // Called by the window's resize callback
+    void markSwapchainDirty() { m_swapchainDirty = true; }
+
+    const std::string& deviceName() const { return m_deviceName; }
+    VkPhysicalDevice physicalDevice() const { return m_physicalDevice; }
+    VkDevice device() const { return m_device; }
+    VkQueue graphicsQueue() const { return m_graphicsQueue; }
+    uint32_t graphicsFamily() const { return static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily); }
+    VkQueue computeQueue() const { return m_computeQueue; }
+    uint32_t computeFamily() const { return static_cast<uint32_t>(m_queueFamilyIndices.computeFamily); }
+    uint32_t framesInFlight() const { return m_framesInFlight; }
+    MemoryArena& memoryArena() { return m_memoryArena; }
+    const FrameTimeline& frameTimeline() const { return m_frameTimeline; }
+    bool timelineSemaphoreSupported() const { return m_timelineSemaphoreSupported; }
+    bool synchronization2Supported() const { return m_synchronization2Supported; }
+    bool externalSemaphoreFdSupported() const { return m_externalSemaphoreFdSupported; }
+
+private:
+    template<SyncStrategy Strategy>
+    friend struct FrameSync;
+
+    struct QueueFamilyIndices
+    {
+        int graphicsFamily = -1;
+        int computeFamily = -1;
+        int presentFamily = -1;
+    };
+
+    typedef RunResult (DeviceContext::*FrameLoop)(const Options&);
+
+    std::set<std::string> getSupportedDeviceExtensions() const;
+    void queryFeatures();
+    void getQueueFamilies();
+    void createDevice();
+    void createRenderPass();
+    void selectPresentMode(VkPresentModeKHR requested);
+    void createSwapchain(VkSwapchainKHR oldSwapchain);
+    void createOffscreenImages();
+    void createSwapchainImageViews();
+    void createFramebuffers();
+    void createCommandPools();
+    void allocateCommandBuffers();
+    void createRenderFinishedSemaphores();
+    void createSemaphores();
+    void createFrameResources(const Options& options);
+    void createSwapchainResources(const Options& options);
+
+    void collectDeletions(uint64_t completedValue, uint64_t retiredPresentId, uint64_t retiredPresentCount);
+    void recreateSwapchain();
+    template<bool Headless>
+    void addPresentSemaphores(SubmitBatcher& submits, uint32_t frameIndex, uint32_t imageIndex);
+    void waitForFence(uint32_t frameIndex);
+    uint64_t fencedCompletedValue() const;
+    void fencedWaitForValue(uint64_t value);
+    void createSyncObjects(SyncStrategy strategy);
+    void destroySyncObjects();
+    void collectGpuTime(uint32_t frameIndex);
+
+    template<bool Headless>
+    uint32_t acquireImage(uint32_t frameIndex, uint64_t frameNumber);
+    void recordRenderPass(VkCommandBuffer cb, uint32_t frameIndex, uint32_t imageIndex, VkCommandBufferUsageFlags usage);
+    VkCommandBuffer recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex);
+    template<bool Headless>
+    void presentImage(uint32_t imageIndex, uint64_t submitNanoseconds);
+    template<typename Sync>
+    void stageUploads();
+    template<bool Headless>
+    bool shouldQuit(uint64_t frameNumber, double elapsedSeconds, const Options& options) const;
+    template<typename Sync>
+    void traceCompletedValues();
+    void traceSubmittedValues(uint64_t submitNanoseconds);
+    template<typename Sync>
+    void paceFrame();
+    template<SyncStrategy Strategy, bool Headless>
+    RunResult runFrameLoop(const Options& options);
+    template<bool Headless>
+    static FrameLoop selectFrameLoop(SyncStrategy strategy);
+
+    VkInstance m_instance = VK_NULL_HANDLE;
+    bool m_headless = false;
+    GLFWwindow* m_window = nullptr;
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+    std::string m_deviceName;
+    QueueFamilyIndices m_queueFamilyIndices;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkExtent2D m_extent{};
+    // Set on resize or a suboptimal acquire, the swapchain is recreated after the frame's present
+    bool m_swapchainDirty = false;
+    bool m_presentWaitSupported = false;
+    // Last id given to vkQueuePresentKHR with VK_KHR_present_id
+    uint64_t m_presentId = 0;
+    // Last present id of the most recently retired swapchain
+    uint64_t m_retiredPresentId = 0;
+    // Presents made so far, the number of the last present of each swapchain image and of the most recently
+    // retired swapchain, and the highest number an acquired image had. A present's semaphore wait isn't covered by
+    // the timeline, but once an image presented after the retirement is acquired again, the presentation engine is
+    // done with every present before it.
+    uint64_t m_presentCount = 0;
+    std::vector<uint64_t> m_imagePresentCounts;
+    uint64_t m_retiredPresentCount = 0;
+    std::atomic<uint64_t> m_acquiredPresentCount{0};
+    PresentWaiter m_presentWaiter;
+    std::vector<VkImage> m_swapchainImages;
+    // Images that can be acquired and not yet presented while an acquire without a timeout is still guaranteed to
+    // return, i.e. the image count minus the surface's minImageCount
+    uint32_t m_spareImageCount = 0;
+    // Transfer source is added when frames are read back
+    VkImageUsageFlags m_swapchainImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    std::vector<MemoryArena::Allocation> m_offscreenImageAllocations;
+    std::vector<VkImageView> m_swapchainImageViews;
+    std::vector<VkFramebuffer> m_framebuffers;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_presentQueue = VK_NULL_HANDLE;
+    VkQueue m_computeQueue = VK_NULL_HANDLE;
+    MemoryArena m_memoryArena;
+    AsyncCompute m_asyncCompute;
+    HostProducer m_hostProducer;
+    ParallelRecorder m_parallelRecorder;
+    RecordMode m_recordMode = RecordMode::Reset;
+    CommandBufferCache m_commandBufferCache;
+    uint32_t m_framesInFlight = 0;
+    std::vector<VkCommandPool> m_graphicsCommandPools;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+    std::vector<VkSemaphore> m_imageAvailableBinarySemaphores;
+    std::vector<VkSemaphore> m_renderFinishedBinarySemaphores;
+    bool m_timelineSemaphoreSupported = false;
+    bool m_calibratedTimestampsSupported = false;
+    bool m_synchronization2Supported = false;
+    // Whether the timeline is to be shared with another process and the device can export and import it
+    bool m_shareTimeline = false;
+    bool m_externalSemaphoreFdSupported = false;
+    SubmitBatcher m_graphicsSubmits;
+    SubmitBatcher m_computeSubmits;
+    SubmitThread m_submitThread;
+    // Whether the current run hands its submissions and presents to m_submitThread, only done with the timeline
+    // strategy
+    bool m_submitOnThread = false;
+    FrameTimeline m_frameTimeline;
+    // Value of the last graphics submission: the timeline value with the timeline strategy and the number of
+    // submissions in the run with the fence based ones. Handles retired at runtime are deferred on it.
+    uint64_t m_submitValue = 0;
+    DeletionQueue m_deletionQueue;
+    CompletionReactor m_completionReactor;
+    UploadRing m_uploadRing;
+    FrameReadback m_frameReadback;
+    // Whether the current run reads its frames back, only done with the timeline strategy
+    bool m_readbackOnRun = false;
+    LatencyHistogram m_readbackLatency;
+    GpuWorkload m_gpuWorkload;
+    VkDeviceSize m_uploadBytesPerFrame = 0;
+    // Stand-in for asset data, copied into the staging ring every frame
+    std::vector<char> m_uploadSource;
+    std::vector<VkFence> m_fences;
+    std::array<VkSemaphore, 2> m_frameChainSemaphores{};
+    // Which of m_frameChainSemaphores the next binary strategy submit signals
+    uint32_t m_chainIndex = 0;
+    GpuTimestamps m_gpuTimestamps;
+    StartupProfiler* m_startupProfiler = nullptr;
+    TraceRecorder* m_trace = nullptr;
+    // Host time of each frame slot's last graphics submission, bounds the GPU clock offset of the trace
+    std::vector<uint64_t> m_submitNanoseconds;
+    // Host time each frame slot's last frame started, after the frame slot wait and pacing
+    std::vector<uint64_t> m_frameStartNanoseconds;
+    FramePacer m_framePacer;
+    uint64_t m_lastSubmitNanoseconds = 0;
+    bool m_pacing = false;
+    FrameStats m_frameStats;
+};
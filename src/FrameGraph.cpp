@@ -0,0 +1,425 @@
+#include "FrameGraph.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <set>
+
+namespace
+{
+size_t toIndex(FrameGraph::Queue queue)
+{
+    return static_cast<size_t>(queue);
+}
+} // namespace
+
+void FrameGraph::create(VkDevice device,
+                        VkQueue graphicsQueue,
+                        uint32_t graphicsFamily,
+                        VkQueue computeQueue,
+                        uint32_t computeFamily,
+                        bool synchronization2,
+                        uint32_t framesInFlight)
+{
+    m_device = device;
+    m_queues[toIndex(Queue::Graphics)] = graphicsQueue;
+    m_queues[toIndex(Queue::Compute)] = computeQueue;
+    const std::array<uint32_t, c_queueCount> families{{graphicsFamily, computeFamily}};
+
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineCreateInfo;
+    for (uint32_t q = 0; q < c_queueCount; ++q)
+    {
+        m_submits[q].create(m_device, m_queues[q], synchronization2, true);
+        VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphores[q]));
+        m_values[q] = 0;
+    }
+
+    m_commandPools.resize(framesInFlight);
+    m_commandBuffers.resize(framesInFlight);
+    m_slotValues.assign(framesInFlight, std::array<uint64_t, c_queueCount>{});
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        for (uint32_t q = 0; q < c_queueCount; ++q)
+        {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = families[q];
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPools[i][q]));
+        }
+    }
+    clear();
+}
+
+void FrameGraph::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    VK_CHECK(vkDeviceWaitIdle(m_device));
+    for (const std::array<VkCommandPool, c_queueCount>& pools : m_commandPools)
+    {
+        for (VkCommandPool pool : pools)
+        {
+            vkDestroyCommandPool(m_device, pool, nullptr);
+        }
+    }
+    m_commandPools.clear();
+    m_commandBuffers.clear();
+    for (VkSemaphore semaphore : m_semaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void FrameGraph::clear()
+{
+    m_resourceCount = 0;
+    m_passes.clear();
+    m_batches.clear();
+    m_batchesPerQueue.fill(0);
+    m_stats = Stats();
+}
+
+uint32_t FrameGraph::addResource()
+{
+    return m_resourceCount++;
+}
+
+void FrameGraph::addPass(const std::string& name,
+                         Queue queue,
+                         const std::vector<uint32_t>& reads,
+                         const std::vector<uint32_t>& writes,
+                         RecordFunction record)
+{
+    // Nothing to overlap with if there is only one queue
+    if (m_queues[toIndex(Queue::Compute)] == m_queues[toIndex(Queue::Graphics)])
+    {
+        queue = Queue::Graphics;
+    }
+
+    Pass pass;
+    pass.name = name;
+    pass.queue = queue;
+    pass.reads = reads;
+    pass.writes = writes;
+    pass.record = std::move(record);
+    pass.barrier = false;
+    m_passes.push_back(std::move(pass));
+}
+
+// Read after write, write after write and write after read hazards in declaration order
+void FrameGraph::findDependencies()
+{
+    std::vector<int> lastWriter(m_resourceCount, -1);
+    std::vector<std::vector<uint32_t>> readers(m_resourceCount);
+    for (uint32_t i = 0; i < m_passes.size(); ++i)
+    {
+        Pass& pass = m_passes[i];
+        pass.dependencies.clear();
+        for (uint32_t resource : pass.reads)
+        {
+            CHECK(resource < m_resourceCount);
+            if (lastWriter[resource] >= 0)
+            {
+                pass.dependencies.push_back(lastWriter[resource]);
+            }
+        }
+        for (uint32_t resource : pass.writes)
+        {
+            CHECK(resource < m_resourceCount);
+            if (lastWriter[resource] >= 0)
+            {
+                pass.dependencies.push_back(lastWriter[resource]);
+            }
+            pass.dependencies.insert(pass.dependencies.end(), readers[resource].begin(), readers[resource].end());
+        }
+        std::sort(pass.dependencies.begin(), pass.dependencies.end());
+        pass.dependencies.erase(std::unique(pass.dependencies.begin(), pass.dependencies.end()), pass.dependencies.end());
+        // A pass that reads and writes a resource doesn't depend on itself
+        pass.dependencies.erase(std::remove(pass.dependencies.begin(), pass.dependencies.end(), i), pass.dependencies.end());
+
+        for (uint32_t resource : pass.reads)
+        {
+            readers[resource].push_back(i);
+        }
+        for (uint32_t resource : pass.writes)
+        {
+            lastWriter[resource] = static_cast<int>(i);
+            readers[resource].clear();
+        }
+    }
+}
+
+// Topological order that stays on a queue while it has passes ready, so that they can share a batch and the
+// other queue's passes are waited for at as few points as possible
+std::vector<uint32_t> FrameGraph::schedule() const
+{
+    const uint32_t passCount = ui32Size(m_passes);
+    std::vector<uint32_t> remaining(passCount);
+    std::vector<std::vector<uint32_t>> dependents(passCount);
+    std::array<std::set<uint32_t>, c_queueCount> ready;
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        remaining[i] = ui32Size(m_passes[i].dependencies);
+        for (uint32_t dependency : m_passes[i].dependencies)
+        {
+            dependents[dependency].push_back(i);
+        }
+        if (remaining[i] == 0)
+        {
+            ready[toIndex(m_passes[i].queue)].insert(i);
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(passCount);
+    size_t queue = toIndex(Queue::Graphics);
+    while (order.size() < passCount)
+    {
+        if (ready[queue].empty())
+        {
+            // Switch to the queue with the earliest declared ready pass
+            for (size_t q = 0; q < c_queueCount; ++q)
+            {
+                if (!ready[q].empty() && (ready[queue].empty() || *ready[q].begin() < *ready[queue].begin()))
+                {
+                    queue = q;
+                }
+            }
+        }
+        const uint32_t pass = *ready[queue].begin();
+        ready[queue].erase(ready[queue].begin());
+        order.push_back(pass);
+        for (uint32_t dependent : dependents[pass])
+        {
+            if (--remaining[dependent] == 0)
+            {
+                ready[toIndex(m_passes[dependent].queue)].insert(dependent);
+            }
+        }
+    }
+    return order;
+}
+
+void FrameGraph::compile()
+{
+    findDependencies();
+    const std::vector<uint32_t> order = schedule();
+
+    m_batches.clear();
+    m_batchesPerQueue.fill(0);
+    m_stats = Stats();
+    m_stats.passCount = ui32Size(m_passes);
+
+    // Batches still open to more passes, -1 once one of their passes was waited for by the other queue
+    std::array<int, c_queueCount> openBatch;
+    openBatch.fill(-1);
+    // Per queue, the latest batch of each queue already waited for by one of its batches
+    std::array<std::array<uint64_t, c_queueCount>, c_queueCount> waited{};
+    // Per queue, position in the order of the latest barrier, which covers every earlier pass on the queue
+    std::array<uint32_t, c_queueCount> lastBarrier{};
+    std::vector<uint32_t> position(m_passes.size());
+    std::vector<uint32_t> batchOfPass(m_passes.size());
+    for (uint32_t p = 0; p < order.size(); ++p)
+    {
+        const uint32_t passIndex = order[p];
+        Pass& pass = m_passes[passIndex];
+        const size_t queue = toIndex(pass.queue);
+        position[passIndex] = p;
+
+        std::array<uint64_t, c_queueCount> needed{};
+        bool barrier = m_batchesPerQueue[queue] == 0;
+        for (uint32_t dependency : pass.dependencies)
+        {
+            Batch& batch = m_batches[batchOfPass[dependency]];
+            const size_t dependencyQueue = toIndex(batch.queue);
+            if (dependencyQueue == queue)
+            {
+                barrier |= position[dependency] >= lastBarrier[queue];
+                continue;
+            }
+            // Passes added to the batch later would delay the signal this waits for
+            if (openBatch[dependencyQueue] == static_cast<int>(batchOfPass[dependency]))
+            {
+                openBatch[dependencyQueue] = -1;
+            }
+            needed[dependencyQueue] = std::max(needed[dependencyQueue], batch.signal);
+        }
+
+        bool wait = false;
+        for (size_t q = 0; q < c_queueCount; ++q)
+        {
+            wait |= needed[q] > waited[queue][q];
+        }
+        if (openBatch[queue] < 0 || wait)
+        {
+            Batch batch;
+            batch.queue = pass.queue;
+            batch.waits.fill(0);
+            batch.waitPrevious = m_batchesPerQueue[queue] == 0;
+            batch.signal = ++m_batchesPerQueue[queue];
+            for (size_t q = 0; q < c_queueCount; ++q)
+            {
+                if (needed[q] > waited[queue][q])
+                {
+                    batch.waits[q] = needed[q];
+                    waited[queue][q] = needed[q];
+                    ++m_stats.crossQueueWaits;
+                }
+            }
+            openBatch[queue] = static_cast<int>(m_batches.size());
+            m_batches.push_back(batch);
+        }
+
+        if (barrier)
+        {
+            pass.barrier = true;
+            lastBarrier[queue] = p;
+            ++m_stats.barrierCount;
+        }
+        else
+        {
+            pass.barrier = false;
+        }
+        batchOfPass[passIndex] = static_cast<uint32_t>(openBatch[queue]);
+        m_batches[openBatch[queue]].passes.push_back(passIndex);
+    }
+    m_stats.batchCount = ui32Size(m_batches);
+}
+
+void FrameGraph::waitForFrameSlot(uint32_t frameIndex)
+{
+    std::array<VkSemaphore, c_queueCount> waitSemaphores;
+    std::array<uint64_t, c_queueCount> waitValues;
+    uint32_t waitCount = 0;
+    for (uint32_t q = 0; q < c_queueCount; ++q)
+    {
+        if (m_slotValues[frameIndex][q] > 0)
+        {
+            waitSemaphores[waitCount] = m_semaphores[q];
+            waitValues[waitCount] = m_slotValues[frameIndex][q];
+            ++waitCount;
+        }
+    }
+    if (waitCount > 0)
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = waitCount;
+        waitInfo.pSemaphores = waitSemaphores.data();
+        waitInfo.pValues = waitValues.data();
+        VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+    }
+}
+
+void FrameGraph::execute(uint32_t frameIndex)
+{
+    waitForFrameSlot(frameIndex);
+
+    std::array<uint32_t, c_queueCount> commandBufferCount{};
+    std::array<uint32_t, c_queueCount> pendingBatches{};
+    for (uint32_t q = 0; q < c_queueCount; ++q)
+    {
+        VK_CHECK(vkResetCommandPool(m_device, m_commandPools[frameIndex][q], 0));
+    }
+
+    // A full barrier is cheap next to tracking per-resource access masks and layouts, the passes only touch
+    // buffers
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    const std::array<uint64_t, c_queueCount> base = m_values;
+    for (const Batch& batch : m_batches)
+    {
+        const size_t queue = toIndex(batch.queue);
+        std::vector<VkCommandBuffer>& commandBuffers = m_commandBuffers[frameIndex][queue];
+        if (commandBufferCount[queue] == commandBuffers.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = m_commandPools[frameIndex][queue];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            commandBuffers.push_back(VK_NULL_HANDLE);
+            VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffers.back()));
+        }
+        const VkCommandBuffer cb = commandBuffers[commandBufferCount[queue]++];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+        for (uint32_t passIndex : batch.passes)
+        {
+            const Pass& pass = m_passes[passIndex];
+            if (pass.barrier)
+            {
+                vkCmdPipelineBarrier(cb,
+                                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                     0,
+                                     1,
+                                     &memoryBarrier,
+                                     0,
+                                     nullptr,
+                                     0,
+                                     nullptr);
+            }
+            pass.record(cb);
+        }
+        VK_CHECK(vkEndCommandBuffer(cb));
+
+        SubmitBatcher& submits = m_submits[queue];
+        if (pendingBatches[queue] == SubmitBatcher::c_maxBatches)
+        {
+            submits.flush();
+            pendingBatches[queue] = 0;
+        }
+        submits.beginBatch();
+        for (size_t q = 0; q < c_queueCount; ++q)
+        {
+            // Values of the other queue's batches may not be submitted yet, timelines allow waiting before signal
+            if (batch.waits[q] > 0)
+            {
+                submits.addWait(m_semaphores[q], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, base[q] + batch.waits[q]);
+            }
+            else if (batch.waitPrevious && q != queue && base[q] > 0)
+            {
+                submits.addWait(m_semaphores[q], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, base[q]);
+            }
+        }
+        submits.addCommandBuffer(cb);
+        submits.addSignal(m_semaphores[queue], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, base[queue] + batch.signal);
+        ++pendingBatches[queue];
+    }
+
+    for (uint32_t q = 0; q < c_queueCount; ++q)
+    {
+        m_submits[q].flush();
+        m_values[q] += m_batchesPerQueue[q];
+    }
+    m_slotValues[frameIndex] = m_values;
+}
+
+void FrameGraph::waitIdle()
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = c_queueCount;
+    waitInfo.pSemaphores = m_semaphores.data();
+    waitInfo.pValues = m_values.data();
+    VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "SubmitBatcher.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Small frame graph that derives the synchronization between passes instead of having it wired by hand. Passes
+// are declared with the queue they run on and the resources they read and write, in an order that is valid on a
+// single queue. compile() turns the resulting DAG into batches, i.e. VkSubmitInfo2s with one command buffer
+// each: consecutive passes on a queue share a batch, a dependency on the same queue becomes a pipeline barrier
+// and one on the other queue a timeline wait on the batch that produced it. Each queue has its own timeline
+// semaphore that every batch signals, so a frame needs no binary semaphores or fences.
+class FrameGraph
+{
+public:
+    enum class Queue
+    {
+        Graphics,
+        Compute,
+        Count
+    };
+
+    typedef std::function<void(VkCommandBuffer)> RecordFunction;
+
+    struct Stats
+    {
+        uint32_t passCount = 0;
+        uint32_t batchCount = 0;
+        // Batches waiting for the other queue within the frame, i.e. cross-queue edges left after merging
+        uint32_t crossQueueWaits = 0;
+        uint32_t barrierCount = 0;
+    };
+
+    // Compute passes run on the graphics queue if both are the same queue. Buffers that both queues access
+    // must be created with VK_SHARING_MODE_CONCURRENT if the families differ, no ownership transfers are made.
+    void create(VkDevice device,
+                VkQueue graphicsQueue,
+                uint32_t graphicsFamily,
+                VkQueue computeQueue,
+                uint32_t computeFamily,
+                bool synchronization2,
+                uint32_t framesInFlight);
+    // Waits for the device
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Removes every pass and resource so that a different graph can be declared
+    void clear();
+    uint32_t addResource();
+    void addPass(const std::string& name,
+                 Queue queue,
+                 const std::vector<uint32_t>& reads,
+                 const std::vector<uint32_t>& writes,
+                 RecordFunction record);
+    void compile();
+
+    const Stats& stats() const { return m_stats; }
+
+    // Blocks until the frame slot's previous execution has completed on both queues
+    void waitForFrameSlot(uint32_t frameIndex);
+    // Records the compiled graph into the frame slot's command buffers and submits it. Waits for the frame slot
+    // first. Each execution is ordered after the previous one on both queues.
+    void execute(uint32_t frameIndex);
+    void waitIdle();
+
+private:
+    static const uint32_t c_queueCount = static_cast<uint32_t>(Queue::Count);
+
+    struct Pass
+    {
+        std::string name;
+        Queue queue;
+        std::vector<uint32_t> reads;
+        std::vector<uint32_t> writes;
+        RecordFunction record;
+        // Passes that must finish first, all declared earlier
+        std::vector<uint32_t> dependencies;
+        // A full memory barrier is recorded before the pass
+        bool barrier;
+    };
+
+    struct Batch
+    {
+        Queue queue;
+        std::vector<uint32_t> passes;
+        // Per queue, the number of the batch on it this one waits for, counted from 1 within an execution, or 0
+        std::array<uint64_t, c_queueCount> waits;
+        // The first batch of each queue also waits for the previous execution on the other one
+        bool waitPrevious;
+        // Number of the batch on its queue, its timeline value relative to the execution's
+        uint64_t signal;
+    };
+
+    void findDependencies();
+    std::vector<uint32_t> schedule() const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::array<VkQueue, c_queueCount> m_queues{};
+    std::array<SubmitBatcher, c_queueCount> m_submits;
+    std::array<VkSemaphore, c_queueCount> m_semaphores{};
+    // Last value each queue's timeline was submitted to signal
+    std::array<uint64_t, c_queueCount> m_values{};
+    // Per frame slot and queue, a command pool with the command buffers allocated from it so far
+    std::vector<std::array<VkCommandPool, c_queueCount>> m_commandPools;
+    std::vector<std::array<std::vector<VkCommandBuffer>, c_queueCount>> m_commandBuffers;
+    std::vector<std::array<uint64_t, c_queueCount>> m_slotValues;
+
+    uint32_t m_resourceCount = 0;
+    std::vector<Pass> m_passes;
+    // In submission order on each queue, the queues' batches interleaved
+    std::vector<Batch> m_batches;
+    std::array<uint64_t, c_queueCount> m_batchesPerQueue{};
+    Stats m_stats;
+};
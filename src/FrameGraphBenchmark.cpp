@@ -0,0 +1,222 @@
+#include "FrameGraphBenchmark.hpp"
+#include "Common.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+// Small enough that a single pass doesn't fill the GPU, which is when running passes on two queues pays off
+const uint32_t c_resolution = 64;
+const uint32_t c_iterations = 1024;
+// Compiles are fast, so the mean is taken over several
+const uint32_t c_compileRepeats = 100;
+} // namespace
+
+void FrameGraphBenchmark::create(VkDevice device,
+                                 MemoryArena& memoryArena,
+                                 VkQueue graphicsQueue,
+                                 uint32_t graphicsFamily,
+                                 VkQueue computeQueue,
+                                 uint32_t computeFamily,
+                                 bool synchronization2,
+                                 uint32_t framesInFlight)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_framesInFlight = framesInFlight;
+    m_queueFamilies.assign(1, graphicsFamily);
+    if (computeFamily != graphicsFamily)
+    {
+        m_queueFamilies.push_back(computeFamily);
+    }
+    m_graph.create(device, graphicsQueue, graphicsFamily, computeQueue, computeFamily, synchronization2, framesInFlight);
+    m_pipeline.create(device);
+}
+
+void FrameGraphBenchmark::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    m_graph.destroy();
+    destroyResources();
+    m_pipeline.destroy();
+    m_device = VK_NULL_HANDLE;
+}
+
+FrameGraphBenchmark::Result FrameGraphBenchmark::run(uint32_t width, uint32_t depth, double seconds)
+{
+    Result result;
+    result.width = width;
+    result.depth = depth;
+    createResources(width * depth);
+
+    declareGraph(width, depth, true);
+    m_graph.compile();
+    result.singleQueueFramesPerSecond = runFrames(seconds, nullptr);
+
+    const uint64_t compileStart = hostNanoseconds();
+    for (uint32_t i = 0; i < c_compileRepeats; ++i)
+    {
+        declareGraph(width, depth, false);
+        m_graph.compile();
+    }
+    result.compileMicroseconds = (hostNanoseconds() - compileStart) / 1000.0 / c_compileRepeats;
+    result.stats = m_graph.stats();
+    result.framesPerSecond = runFrames(seconds, &result.execute);
+
+    destroyResources();
+    return result;
+}
+
+void FrameGraphBenchmark::printResults(const std::vector<Result>& results)
+{
+    printf("\n%6s %6s %7s %8s %7s %9s %11s %11s %11s %11s %8s\n",
+           "width",
+           "depth",
+           "passes",
+           "batches",
+           "waits",
+           "barriers",
+           "compile us",
+           "execute us",
+           "1 queue/s",
+           "2 queues/s",
+           "speedup");
+    for (const Result& result : results)
+    {
+        printf("%6u %6u %7u %8u %7u %9u %11.1f %11.1f %11.1f %11.1f %8.2f\n",
+               result.width,
+               result.depth,
+               result.stats.passCount,
+               result.stats.batchCount,
+               result.stats.crossQueueWaits,
+               result.stats.barrierCount,
+               result.compileMicroseconds,
+               result.execute.mean() / 1000.0,
+               result.singleQueueFramesPerSecond,
+               result.framesPerSecond,
+               result.singleQueueFramesPerSecond > 0.0 ? result.framesPerSecond / result.singleQueueFramesPerSecond : 0.0);
+    }
+}
+
+void FrameGraphBenchmark::createResources(uint32_t count)
+{
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = count;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = count;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool));
+
+    m_buffers.resize(count);
+    m_bufferAllocations.resize(count);
+    m_descriptorSets.resize(count);
+    const VkDeviceSize size = static_cast<VkDeviceSize>(c_resolution) * c_resolution * 4 * sizeof(float);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        m_bufferAllocations[i] = m_memoryArena->createBuffer(size,
+                                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                             m_buffers[i],
+                                                             MemoryArena::c_transient,
+                                                             ui32Size(m_queueFamilies),
+                                                             m_queueFamilies.data());
+
+        m_descriptorSets[i] = m_pipeline.allocateDescriptorSet(m_descriptorPool, m_buffers[i]);
+    }
+}
+
+void FrameGraphBenchmark::destroyResources()
+{
+    for (size_t i = 0; i < m_buffers.size(); ++i)
+    {
+        m_memoryArena->destroyBuffer(m_buffers[i], m_bufferAllocations[i]);
+    }
+    m_buffers.clear();
+    m_bufferAllocations.clear();
+    m_descriptorSets.clear();
+    if (m_descriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+        m_descriptorPool = VK_NULL_HANDLE;
+    }
+}
+
+// Seeded by the shape, so that the single and multi-queue runs and repeated runs get the same graph
+void FrameGraphBenchmark::declareGraph(uint32_t width, uint32_t depth, bool singleQueue)
+{
+    std::mt19937 random(width * 1000 + depth);
+    m_graph.clear();
+    for (uint32_t i = 0; i < width * depth; ++i)
+    {
+        m_graph.addResource();
+    }
+
+    std::vector<uint32_t> reads;
+    for (uint32_t layer = 0; layer < depth; ++layer)
+    {
+        for (uint32_t i = 0; i < width; ++i)
+        {
+            const uint32_t resource = layer * width + i;
+            reads.clear();
+            if (layer > 0)
+            {
+                const uint32_t readCount = 1 + random() % 2;
+                for (uint32_t r = 0; r < readCount; ++r)
+                {
+                    reads.push_back((layer - 1) * width + random() % width);
+                }
+            }
+            const bool compute = random() % 2 == 1;
+            m_graph.addPass("pass",
+                            compute && !singleQueue ? FrameGraph::Queue::Compute : FrameGraph::Queue::Graphics,
+                            reads,
+                            std::vector<uint32_t>(1, resource),
+                            [this, resource](VkCommandBuffer cb) { recordPass(cb, resource); });
+        }
+    }
+}
+
+// The pass only binds the buffer it writes, its reads are declared for the dependencies they create
+void FrameGraphBenchmark::recordPass(VkCommandBuffer cb, uint32_t resource)
+{
+    m_pipeline.cmdBind(cb, m_descriptorSets[resource]);
+    m_pipeline.cmdDispatch(cb, c_resolution, c_resolution, c_iterations, resource);
+}
+
+double FrameGraphBenchmark::runFrames(double seconds, LatencyHistogram* execute)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const Clock::time_point startTime = Clock::now();
+    uint64_t frameCount = 0;
+    uint32_t frameIndex = 0;
+    while (std::chrono::duration<double>(Clock::now() - startTime).count() < seconds)
+    {
+        // Waited for separately so that the execute time is only the scheduling overhead, not GPU time
+        m_graph.waitForFrameSlot(frameIndex);
+        const uint64_t executeStart = hostNanoseconds();
+        m_graph.execute(frameIndex);
+        if (execute)
+        {
+            execute->add(hostNanoseconds() - executeStart);
+        }
+        ++frameCount;
+        frameIndex = (frameIndex + 1) % m_framesInFlight;
+    }
+
+    // The last frames can still be running on either queue, and the multi-queue schedule only pays off once both
+    // queues have finished them
+    m_graph.waitIdle();
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    return elapsedSeconds > 0.0 ? frameCount / elapsedSeconds : 0.0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FrameGraph.hpp"
+#include "MemoryArena.hpp"
+#include "Timing.hpp"
+#include "WorkloadPipeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Runs randomly generated frame graphs of a given width and depth. Each layer has width passes that each write
+// their own buffer with an ALU-bound dispatch and read one or two buffers of the previous layer, and every pass
+// is put on the graphics or compute queue at random. The same graph also runs with every pass on the graphics
+// queue, so comparing the two frame rates shows how much GPU overlap the compiled multi-queue schedule gains.
+class FrameGraphBenchmark
+{
+public:
+    struct Result
+    {
+        uint32_t width = 0;
+        uint32_t depth = 0;
+        FrameGraph::Stats stats;
+        // Mean time to declare and compile the graph
+        double compileMicroseconds = 0.0;
+        // CPU time of recording and submitting the compiled graph per frame
+        LatencyHistogram execute;
+        double framesPerSecond = 0.0;
+        double singleQueueFramesPerSecond = 0.0;
+    };
+
+    void create(VkDevice device,
+                MemoryArena& memoryArena,
+                VkQueue graphicsQueue,
+                uint32_t graphicsFamily,
+                VkQueue computeQueue,
+                uint32_t computeFamily,
+                bool synchronization2,
+                uint32_t framesInFlight);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Runs the graph on both queues and then on the graphics queue only, for about the given time each
+    Result run(uint32_t width, uint32_t depth, double seconds);
+
+    static void printResults(const std::vector<Result>& results);
+
+private:
+    void createResources(uint32_t count);
+    void destroyResources();
+    void declareGraph(uint32_t width, uint32_t depth, bool singleQueue);
+    void recordPass(VkCommandBuffer cb, uint32_t resource);
+    // Returns frames per second, execute is optional
+    double runFrames(double seconds, LatencyHistogram* execute);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    MemoryArena* m_memoryArena = nullptr;
+    // Both families when they differ, so the buffers can be shared without ownership transfers
+    std::vector<uint32_t> m_queueFamilies;
+    uint32_t m_framesInFlight = 0;
+    FrameGraph m_graph;
+
+    WorkloadPipeline m_pipeline;
+
+    // One storage buffer per graph resource
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkBuffer> m_buffers;
+    std::vector<MemoryArena::Allocation> m_bufferAllocations;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+};
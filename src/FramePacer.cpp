@@ -0,0 +1,44 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+
+namespace
+{
+// Weight of a new sample is 1 / 2^c_smoothingShift
+const uint32_t c_smoothingShift = 3;
+// Slack for sleep overshoot and frame time variance so that the GPU doesn't run dry waiting for the submission
+const uint64_t c_minMargin = 200000;
+
+uint64_t smooth(uint64_t average, uint64_t sample)
+{
+    if (average == 0)
+    {
+        return sample;
+    }
+    return average - (average >> c_smoothingShift) + (sample >> c_smoothingShift);
+}
+} // namespace
+
+void FramePacer::reset()
+{
+    m_gpuNanoseconds = 0;
+    m_cpuNanoseconds = 0;
+}
+
+void FramePacer::addGpuTime(uint64_t nanoseconds)
+{
+    m_gpuNanoseconds = smooth(m_gpuNanoseconds, nanoseconds);
+}
+
+void FramePacer::addCpuTime(uint64_t nanoseconds)
+{
+    m_cpuNanoseconds = smooth(m_cpuNanoseconds, nanoseconds);
+}
+
+uint64_t FramePacer::nextFrameStart(uint64_t previousCompletion, uint64_t lastSubmit) const
+{
+    // The last submission starts on the GPU once it was made and the one before it has completed
+    const uint64_t predictedCompletion = std::max(previousCompletion, lastSubmit) + m_gpuNanoseconds;
+    const uint64_t lead = m_cpuNanoseconds + std::max(c_minMargin, m_gpuNanoseconds / 10);
+    return predictedCompletion > lead ? predictedCompletion - lead : 0;
+}
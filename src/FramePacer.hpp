@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Latency limiter in the style of NVIDIA Reflex. Instead of starting a frame as soon as a frame slot is free,
+// which keeps as many frames queued as the slots allow, the start is delayed until the frame would be
+// submitted just as the GPU finishes the one before it. The GPU stays fed while the input the frame is built
+// from is as fresh as possible. The GPU and CPU frame times are smoothed with an exponential moving average.
+class FramePacer
+{
+public:
+    void reset();
+
+    // GPU busy time of a completed frame from timestamp queries. Without them nothing is delayed and pacing
+    // only limits the queue to a single frame.
+    void addGpuTime(uint64_t nanoseconds);
+    // CPU time from the frame start to its queue submission
+    void addCpuTime(uint64_t nanoseconds);
+
+    // Host time at which the next frame should start. previousCompletion is when the second to last submission
+    // completed, or 0 if it is unknown, and lastSubmit when the last submission was made.
+    uint64_t nextFrameStart(uint64_t previousCompletion, uint64_t lastSubmit) const;
+
+    uint64_t gpuEstimate() const { return m_gpuNanoseconds; }
+    uint64_t cpuEstimate() const { return m_cpuNanoseconds; }
+
+private:
+    uint64_t m_gpuNanoseconds = 0;
+    uint64_t m_cpuNanoseconds = 0;
+};
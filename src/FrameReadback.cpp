@@ -0,0 +1,316 @@
+#include "FrameReadback.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+const VkDeviceSize c_bytesPerPixel = 4;
+const uint64_t c_fnvOffsetBasis = 14695981039346656037ull;
+const uint64_t c_fnvPrime = 1099511628211ull;
+} // namespace
+
+void FrameReadback::create(VkDevice device,
+                           VkPhysicalDevice physicalDevice,
+                           MemoryArena& memoryArena,
+                           VkExtent2D extent,
+                           uint32_t slotCount,
+                           const std::string& captureDirectory,
+                           TraceRecorder& trace)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_slotCount = slotCount;
+    m_captureDirectory = captureDirectory;
+    m_trace = &trace;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    // Slots are copied to at the device's preferred offset alignment, and invalidated one at a time, so they
+    // also have to start on a non-coherent atom. Copy offsets must be a multiple of the texel size as well.
+    const VkDeviceSize alignment = std::max(std::max(c_bytesPerPixel, properties.limits.optimalBufferCopyOffsetAlignment),
+                                            properties.limits.nonCoherentAtomSize);
+    const VkDeviceSize frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * c_bytesPerPixel;
+    m_slotSize = (frameSize + alignment - 1) / alignment * alignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_slotSize * m_slotCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VK_CHECK(vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_buffer));
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, m_buffer, &memoryRequirements);
+
+    // Cached memory makes the consumer's reads fast, uncached host-visible memory is the fallback
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    uint32_t memoryType = UINT32_MAX;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; ++i)
+    {
+        if ((memoryRequirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & cached) == cached)
+        {
+            memoryType = i;
+        }
+    }
+    if (memoryType == UINT32_MAX)
+    {
+        memoryType = findMemoryType(physicalDevice,
+                                    memoryRequirements.memoryTypeBits,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    const VkMemoryPropertyFlags memoryFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+    m_coherent = (memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    // Asking for every flag of the chosen type makes the arena pick that same type
+    m_allocation = m_memoryArena->allocate(memoryRequirements, memoryFlags, MemoryArena::Tiling::Linear);
+    VK_CHECK(vkBindBufferMemory(m_device, m_buffer, m_allocation.memory, m_allocation.offset));
+
+    m_freeSlots.clear();
+    for (uint32_t i = 0; i < m_slotCount; ++i)
+    {
+        m_freeSlots.push_back(m_slotCount - 1 - i);
+    }
+    m_recordedSlot = UINT32_MAX;
+    m_framesSubmitted = 0;
+    m_stopping = false;
+    resetCounters();
+    m_consumer = std::thread(&FrameReadback::consumerLoop, this);
+}
+
+void FrameReadback::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_frameSubmitted.notify_one();
+    m_consumer.join();
+
+    m_memoryArena->destroyBuffer(m_buffer, m_allocation);
+    m_frames.clear();
+    m_freeSlots.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+bool FrameReadback::cmdCopy(VkCommandBuffer cb, VkImage image, VkImageLayout layout, VkExtent2D extent)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A swapchain that grew since creation doesn't fit into the slots
+        if (m_freeSlots.empty() || static_cast<VkDeviceSize>(extent.width) * extent.height * c_bytesPerPixel > m_slotSize)
+        {
+            ++m_framesSkipped;
+            return false;
+        }
+        m_recordedSlot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    m_recordedExtent = extent;
+
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = layout;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cb,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         1,
+                         &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = m_recordedSlot * m_slotSize;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cb, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_buffer, 1, &region);
+
+    // The next frame's render pass must not overwrite the image before the copy has read it, and the host only
+    // sees the copy through a barrier to the host stage
+    VkImageMemoryBarrier toLayout = toTransfer;
+    toLayout.srcAccessMask = 0;
+    toLayout.dstAccessMask = 0;
+    toLayout.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toLayout.newLayout = layout;
+
+    VkBufferMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = m_buffer;
+    toHost.offset = region.bufferOffset;
+    toHost.size = m_slotSize;
+    vkCmdPipelineBarrier(cb,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         1,
+                         &toHost,
+                         1,
+                         &toLayout);
+    return true;
+}
+
+void FrameReadback::submitted(VkSemaphore semaphore, uint64_t value)
+{
+    if (m_recordedSlot == UINT32_MAX)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.push_back({m_framesSubmitted++, m_recordedSlot, m_recordedExtent, semaphore, value, hostNanoseconds()});
+    }
+    m_frameSubmitted.notify_one();
+    m_recordedSlot = UINT32_MAX;
+}
+
+void FrameReadback::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_frameConsumed.wait(lock, [this] { return m_frames.empty() && !m_consuming; });
+}
+
+uint64_t FrameReadback::framesRead() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesRead;
+}
+
+uint64_t FrameReadback::framesSkipped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesSkipped;
+}
+
+uint64_t FrameReadback::lastChecksum() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastChecksum;
+}
+
+void FrameReadback::collect(LatencyHistogram& histogram)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    histogram = m_latencies;
+    m_latencies.reset();
+}
+
+void FrameReadback::resetCounters()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_framesRead = 0;
+    m_framesSkipped = 0;
+    m_latencies.reset();
+}
+
+void FrameReadback::consumerLoop()
+{
+    m_trace->nameThread("readback");
+    for (;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameSubmitted.wait(lock, [this] { return m_stopping || !m_frames.empty(); });
+            // Frames still queued were submitted, so they are consumed before stopping
+            if (m_frames.empty())
+            {
+                return;
+            }
+            frame = m_frames.front();
+            m_frames.pop_front();
+            m_consuming = true;
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &frame.semaphore;
+        waitInfo.pValues = &frame.value;
+        VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+
+        const uint64_t beginNanoseconds = hostNanoseconds();
+        consume(frame);
+        const uint64_t endNanoseconds = hostNanoseconds();
+        m_trace->span("readback", beginNanoseconds, endNanoseconds);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeSlots.push_back(frame.slot);
+            m_latencies.add(endNanoseconds - frame.submitNanoseconds);
+            ++m_framesRead;
+            m_consuming = false;
+        }
+        m_frameConsumed.notify_all();
+    }
+}
+
+void FrameReadback::consume(const Frame& frame)
+{
+    const VkDeviceSize offset = frame.slot * m_slotSize;
+    if (!m_coherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = m_allocation.memory;
+        range.offset = m_allocation.offset + offset;
+        range.size = m_slotSize;
+        VK_CHECK(vkInvalidateMappedMemoryRanges(m_device, 1, &range));
+    }
+
+    const unsigned char* pixels = reinterpret_cast<const unsigned char*>(m_allocation.data + offset);
+    const size_t pixelCount = static_cast<size_t>(frame.extent.width) * frame.extent.height;
+    uint64_t checksum = c_fnvOffsetBasis;
+    for (size_t i = 0; i < pixelCount * c_bytesPerPixel; ++i)
+    {
+        checksum = (checksum ^ pixels[i]) * c_fnvPrime;
+    }
+
+    if (!m_captureDirectory.empty())
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame-%06llu.ppm", static_cast<unsigned long long>(frame.number));
+        const std::string path = m_captureDirectory + name;
+        FILE* file = fopen(path.c_str(), "wb");
+        CHECK(file);
+
+        // PPM has no alpha and stores RGB, the frames are BGRA
+        std::vector<unsigned char> rgb(pixelCount * 3);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            rgb[i * 3 + 0] = pixels[i * c_bytesPerPixel + 2];
+            rgb[i * 3 + 1] = pixels[i * c_bytesPerPixel + 1];
+            rgb[i * 3 + 2] = pixels[i * c_bytesPerPixel + 0];
+        }
+        fprintf(file, "P6\n%u %u\n255\n", frame.extent.width, frame.extent.height);
+        fwrite(rgb.data(), 1, rgb.size(), file);
+        fclose(file);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastChecksum = checksum;
+}
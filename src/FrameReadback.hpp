@@ -0,0 +1,98 @@
+#pragma once
+
+#include "MemoryArena.hpp"
+#include "Timing.hpp"
+#include "Trace.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Copies rendered frames into a ring of host-visible buffers and hands each one to a consumer thread once the
+// timeline value of the submission that copied it is reached. The consumer checksums the pixels and optionally
+// writes them to disk as PPM files. The render loop never waits for it: a frame is skipped when every slot is
+// still owned by the consumer.
+class FrameReadback
+{
+public:
+    // Frames are B8G8R8A8 and at most extent large, captureDirectory is empty to only checksum them
+    void create(VkDevice device,
+                VkPhysicalDevice physicalDevice,
+                MemoryArena& memoryArena,
+                VkExtent2D extent,
+                uint32_t slotCount,
+                const std::string& captureDirectory,
+                TraceRecorder& trace);
+    // Consumes every frame that was submitted, so the device must be idle
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Records the copy of image, which is in layout and left there, into a free slot. Returns false and skips
+    // the frame if there is none.
+    bool cmdCopy(VkCommandBuffer cb, VkImage image, VkImageLayout layout, VkExtent2D extent);
+    // Hands the frame recorded by the last successful cmdCopy() to the consumer, which waits for value on
+    // semaphore. Does nothing if the frame was skipped.
+    void submitted(VkSemaphore semaphore, uint64_t value);
+    // Blocks until the consumer has processed every submitted frame
+    void waitIdle();
+
+    uint64_t framesRead() const;
+    uint64_t framesSkipped() const;
+    // FNV-1a hash of the pixels of the last frame the consumer processed
+    uint64_t lastChecksum() const;
+    // Moves the times from submission until the consumer was done with each frame into histogram
+    void collect(LatencyHistogram& histogram);
+    void resetCounters();
+
+private:
+    struct Frame
+    {
+        // Counted from 0 since the readback was created, names the captured file
+        uint64_t number;
+        uint32_t slot;
+        VkExtent2D extent;
+        VkSemaphore semaphore;
+        uint64_t value;
+        uint64_t submitNanoseconds;
+    };
+
+    void consumerLoop();
+    void consume(const Frame& frame);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    MemoryArena* m_memoryArena = nullptr;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_allocation{};
+    // Non-coherent memory is invalidated before the consumer reads a slot
+    bool m_coherent = true;
+    VkDeviceSize m_slotSize = 0;
+    uint32_t m_slotCount = 0;
+    std::string m_captureDirectory;
+    TraceRecorder* m_trace = nullptr;
+
+    // Slot and extent of the frame recorded but not yet submitted, only touched by the render thread
+    uint32_t m_recordedSlot = UINT32_MAX;
+    VkExtent2D m_recordedExtent{};
+
+    std::thread m_consumer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_frameSubmitted;
+    std::condition_variable m_frameConsumed;
+    std::vector<uint32_t> m_freeSlots;
+    std::deque<Frame> m_frames;
+    // The frame the consumer is working on is neither free nor queued
+    bool m_consuming = false;
+    bool m_stopping = false;
+    uint64_t m_framesSubmitted = 0;
+    uint64_t m_framesRead = 0;
+    uint64_t m_framesSkipped = 0;
+    uint64_t m_lastChecksum = 0;
+    LatencyHistogram m_latencies;
+};
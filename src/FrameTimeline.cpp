@@ -0,0 +1,62 @@
+#include "FrameTimeline.hpp"
+#include "Common.hpp"
+#include "SharedTimeline.hpp"
+
+void FrameTimeline::create(VkDevice device, uint32_t framesInFlight, bool exportable)
+{
+    m_device = device;
+    m_framesInFlight = framesInFlight;
+    m_value = 0;
+
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    const VkExportSemaphoreCreateInfo exportCreateInfo = SharedTimeline::exportCreateInfo(&timelineCreateInfo);
+
+    VkSemaphoreCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = exportable ? static_cast<const void*>(&exportCreateInfo) : &timelineCreateInfo;
+    VK_CHECK(vkCreateSemaphore(m_device, &createInfo, nullptr, &m_semaphore));
+}
+
+void FrameTimeline::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+    m_semaphore = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+}
+
+void FrameTimeline::waitForFrameSlot() const
+{
+    if (m_value < m_framesInFlight)
+    {
+        return;
+    }
+
+    waitForValue(m_value + 1 - m_framesInFlight);
+}
+
+uint64_t FrameTimeline::completedValue() const
+{
+    uint64_t value;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_semaphore, &value));
+    return value;
+}
+
+void FrameTimeline::waitForValue(uint64_t value) const
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+}
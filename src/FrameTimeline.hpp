@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Timeline semaphore that every frame's last submission signals with the next value. A frame slot is reused once
+// the value signaled framesInFlight frames earlier is reached, so the frame loop needs no fence per slot.
+class FrameTimeline
+{
+public:
+    // Exportable timelines can be shared with another process by SharedTimeline
+    void create(VkDevice device, uint32_t framesInFlight, bool exportable);
+    // The device must be idle
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    VkSemaphore semaphore() const { return m_semaphore; }
+    // Last value signaled. Never reset so that consecutive benchmark runs keep it monotonic.
+    uint64_t value() const { return m_value; }
+    // Reserves the value the next frame's submission signals
+    uint64_t nextValue() { return ++m_value; }
+
+    // Blocks until the submission that last used the frame slot of the next value has completed
+    void waitForFrameSlot() const;
+    // Doesn't block
+    uint64_t completedValue() const;
+    void waitForValue(uint64_t value) const;
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_framesInFlight = 0;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_value = 0;
+};
@@ -0,0 +1,270 @@
+#include "GpuWorkload.hpp"
+#include "Common.hpp"
+
+#include <array>
+
+namespace
+{
+// Generated from shaders/ by glslc -mfmt=c at build time
+const uint32_t c_fullscreenVertSpirv[] =
+#include "fullscreen.vert.inc"
+    ;
+const uint32_t c_workloadFragSpirv[] =
+#include "workload.frag.inc"
+    ;
+} // namespace
+
+void GpuWorkload::create(VkDevice device,
+                         MemoryArena& memoryArena,
+                         VkQueue queue,
+                         uint32_t queueFamily,
+                         VkRenderPass renderPass,
+                         const Settings& settings)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_settings = settings;
+
+    if (m_settings.dispatchCount > 0)
+    {
+        const VkDeviceSize size = static_cast<VkDeviceSize>(m_settings.resolution.width) * m_settings.resolution.height * 4 * sizeof(float);
+        m_bufferAllocation = m_memoryArena->createBuffer(size,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                         m_buffer);
+        clearBuffer(queue, queueFamily);
+        createComputePipeline();
+    }
+    if (m_settings.drawCount > 0)
+    {
+        createGraphicsPipeline(renderPass);
+    }
+}
+
+void GpuWorkload::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    if (m_computePipeline.isEnabled())
+    {
+        m_computePipeline.destroy();
+        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+        m_memoryArena->destroyBuffer(m_buffer, m_bufferAllocation);
+    }
+    if (m_graphicsPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_graphicsPipelineLayout, nullptr);
+    }
+    m_graphicsPipeline = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+}
+
+void GpuWorkload::cmdDispatch(VkCommandBuffer cb)
+{
+    if (m_settings.dispatchCount == 0)
+    {
+        return;
+    }
+
+    m_computePipeline.cmdBind(cb, m_descriptorSet);
+
+    // Every dispatch reads and writes the whole buffer, the first one after the previous frame's last
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    for (uint32_t i = 0; i < m_settings.dispatchCount; ++i)
+    {
+        vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        m_computePipeline.cmdDispatch(cb, m_settings.resolution.width, m_settings.resolution.height, m_settings.iterations, i);
+    }
+}
+
+void GpuWorkload::cmdDraw(VkCommandBuffer cb, VkExtent2D extent)
+{
+    if (m_settings.drawCount == 0)
+    {
+        return;
+    }
+
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = extent;
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    WorkloadPipeline::PushConstants pushConstants{extent.width, extent.height, m_settings.iterations, 0};
+    for (uint32_t i = 0; i < m_settings.drawCount; ++i)
+    {
+        pushConstants.index = i;
+        vkCmdPushConstants(cb, m_graphicsPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDraw(cb, 3, 1, 0, 0);
+    }
+}
+
+// The loop's cost must not depend on whatever the memory held before, e.g. denormals or NaNs
+void GpuWorkload::clearBuffer(VkQueue queue, uint32_t queueFamily)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    VkCommandPool commandPool;
+    VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &commandPool));
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer cb;
+    VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &cb));
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+    vkCmdFillBuffer(cb, m_buffer, 0, VK_WHOLE_SIZE, 0);
+    VK_CHECK(vkEndCommandBuffer(cb));
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    VK_CHECK(vkCreateFence(m_device, &fenceInfo, nullptr, &fence));
+
+    // Waiting for the fence makes the fill visible to every later submission
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cb;
+    VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, fence));
+    VK_CHECK(vkWaitForFences(m_device, 1, &fence, VK_TRUE, c_timeout));
+
+    vkDestroyFence(m_device, fence, nullptr);
+    vkDestroyCommandPool(m_device, commandPool, nullptr);
+}
+
+void GpuWorkload::createComputePipeline()
+{
+    m_computePipeline.create(m_device);
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool));
+
+    m_descriptorSet = m_computePipeline.allocateDescriptorSet(m_descriptorPool, m_buffer);
+}
+
+void GpuWorkload::createGraphicsPipeline(VkRenderPass renderPass)
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(WorkloadPipeline::PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK(vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_graphicsPipelineLayout));
+
+    VkShaderModule vertexModule = createShaderModule(c_fullscreenVertSpirv, sizeof(c_fullscreenVertSpirv));
+    VkShaderModule fragmentModule = createShaderModule(c_workloadFragSpirv, sizeof(c_workloadFragSpirv));
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> stages{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexModule;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentModule;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Viewport and scissor are dynamic so that the pipeline survives swapchain recreation
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    const std::array<VkDynamicState, 2> dynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = ui32Size(dynamicStates);
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = ui32Size(stages);
+    pipelineInfo.pStages = stages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_graphicsPipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    VK_CHECK(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+
+    vkDestroyShaderModule(m_device, fragmentModule, nullptr);
+    vkDestroyShaderModule(m_device, vertexModule, nullptr);
+}
+
+VkShaderModule GpuWorkload::createShaderModule(const uint32_t* code, size_t size)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = code;
+
+    VkShaderModule shaderModule;
+    VK_CHECK(vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule));
+    return shaderModule;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "MemoryArena.hpp"
+#include "WorkloadPipeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Synthetic GPU load so that frame pacing can be measured GPU-bound as well as CPU-bound. Compute dispatches run
+// an ALU loop over a storage buffer of the given resolution before the render pass, and full-screen draws run
+// the same loop per pixel inside it. The shaders are compiled to SPIR-V at build time and embedded.
+class GpuWorkload
+{
+public:
+    struct Settings
+    {
+        uint32_t dispatchCount = 0;
+        uint32_t drawCount = 0;
+        // Loop iterations per invocation, the cost per element or pixel
+        uint32_t iterations = 64;
+        // Elements each compute dispatch processes
+        VkExtent2D resolution{1024, 1024};
+    };
+
+    // The storage buffer is cleared on queue, which must not be used by another thread meanwhile
+    void create(VkDevice device,
+                MemoryArena& memoryArena,
+                VkQueue queue,
+                uint32_t queueFamily,
+                VkRenderPass renderPass,
+                const Settings& settings);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Must be recorded outside of a render pass
+    void cmdDispatch(VkCommandBuffer cb);
+    // Must be recorded inside the render pass given to create(), inline
+    void cmdDraw(VkCommandBuffer cb, VkExtent2D extent);
+
+private:
+    void clearBuffer(VkQueue queue, uint32_t queueFamily);
+    void createComputePipeline();
+    void createGraphicsPipeline(VkRenderPass renderPass);
+    VkShaderModule createShaderModule(const uint32_t* code, size_t size);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    Settings m_settings;
+
+    MemoryArena* m_memoryArena = nullptr;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_bufferAllocation{};
+    WorkloadPipeline m_computePipeline;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_graphicsPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,223 @@
+#include "HostProducer.hpp"
+#include "Common.hpp"
+
+namespace
+{
+const VkDeviceSize c_slotSize = 1024 * 1024;
+} // namespace
+
+void HostProducer::create(VkInstance instance,
+                          VkDevice device,
+                          VkPhysicalDevice physicalDevice,
+                          MemoryArena& memoryArena,
+                          uint32_t queueFamily,
+                          uint32_t threadCount,
+                          uint32_t framesInFlight,
+                          bool calibratedTimestamps,
+                          TraceRecorder& trace)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_trace = &trace;
+
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineCreateInfo;
+    VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_commandPools.resize(framesInFlight);
+    m_commandBuffers.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPools[i]));
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffers[i]));
+    }
+
+    // One slot per frame in flight in both buffers, a slot is reused only after the frame that last used it
+    // has completed
+    const VkDeviceSize size = c_slotSize * framesInFlight;
+    m_stagingAllocation = m_memoryArena->createBuffer(size,
+                                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                      m_stagingBuffer);
+    m_deviceAllocation = m_memoryArena->createBuffer(size,
+                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                     m_deviceBuffer);
+
+    m_timestamps.create(m_device, physicalDevice, queueFamily, framesInFlight);
+    if (!calibratedTimestamps || !m_timestamps.calibrate(instance, physicalDevice))
+    {
+        printf("GPU timestamps can not be calibrated against the host clock, handoff latency is not measured\n");
+    }
+
+    m_slotTimings.assign(framesInFlight, SlotTiming());
+    m_stopping = false;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_workers.push_back(std::thread(&HostProducer::workerLoop, this));
+    }
+}
+
+void HostProducer::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    m_timestamps.destroy();
+    m_memoryArena->destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+    m_memoryArena->destroyBuffer(m_deviceBuffer, m_deviceAllocation);
+    for (const VkCommandPool& commandPool : m_commandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+    m_device = VK_NULL_HANDLE;
+}
+
+void HostProducer::submitFrame(SubmitBatcher& submits, uint32_t frameIndex)
+{
+    const Job job{frameIndex, ++m_value};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+    m_jobAvailable.notify_one();
+
+    VkCommandBuffer cb = m_commandBuffers[frameIndex];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkBufferCopy region{};
+    region.srcOffset = c_slotSize * frameIndex;
+    region.dstOffset = c_slotSize * frameIndex;
+    region.size = c_slotSize;
+
+    VK_CHECK(vkResetCommandPool(m_device, m_commandPools[frameIndex], 0));
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+    m_timestamps.cmdBegin(cb, frameIndex);
+    vkCmdCopyBuffer(cb, m_stagingBuffer, m_deviceBuffer, 1, &region);
+    m_timestamps.cmdEnd(cb, frameIndex);
+    VK_CHECK(vkEndCommandBuffer(cb));
+
+    // Submitted before the worker is likely to have signaled, the queue resolves the wait on its own
+    submits.beginBatch();
+    submits.addWait(m_semaphore, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, job.value);
+    submits.addCommandBuffer(cb);
+}
+
+void HostProducer::collectStats(uint32_t frameIndex, FrameStats& stats)
+{
+    GpuInterval copy;
+    const bool hasCopy = m_timestamps.collect(frameIndex, copy);
+    if (hasCopy)
+    {
+        m_trace->gpuSpan("graphics", "host data copy", copy.begin, copy.end);
+    }
+
+    SlotTiming timing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        timing = m_slotTimings[frameIndex];
+        m_slotTimings[frameIndex].pending = false;
+    }
+    if (!timing.pending)
+    {
+        return;
+    }
+
+    stats.phase(FramePhase::Produce).add(timing.produceNanoseconds);
+    if (hasCopy && m_timestamps.isCalibrated())
+    {
+        const uint64_t copyEnd = m_timestamps.toHostNanoseconds(copy.end);
+        stats.phase(FramePhase::Handoff).add(copyEnd > timing.signalNanoseconds ? copyEnd - timing.signalNanoseconds : 0);
+    }
+}
+
+void HostProducer::workerLoop()
+{
+    m_trace->nameThread("host producer");
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+        produce(job);
+    }
+}
+
+void HostProducer::produce(const Job& job)
+{
+    const uint64_t start = hostNanoseconds();
+
+    // Stand-in for the per-frame data a streaming renderer generates, written straight into mapped memory
+    uint32_t* words = reinterpret_cast<uint32_t*>(m_stagingAllocation.data + c_slotSize * job.frameIndex);
+    uint32_t state = static_cast<uint32_t>(job.value) | 1u;
+    for (size_t i = 0; i < c_slotSize / sizeof(uint32_t); ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        words[i] = state;
+    }
+    const uint64_t produced = hostNanoseconds();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_signalOrder.wait(lock, [this, &job] { return m_signaledValue + 1 == job.value; });
+
+    SlotTiming& timing = m_slotTimings[job.frameIndex];
+    timing.signalNanoseconds = hostNanoseconds();
+    timing.produceNanoseconds = produced - start;
+    timing.pending = true;
+
+    VkSemaphoreSignalInfo signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.semaphore = m_semaphore;
+    signalInfo.value = job.value;
+    VK_CHECK(vkSignalSemaphore(m_device, &signalInfo));
+
+    m_signaledValue = job.value;
+    m_signalOrder.notify_all();
+
+    m_trace->span("produce", start, produced);
+    m_trace->counter("host timeline signaled", timing.signalNanoseconds, job.value);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MemoryArena.hpp"
+#include "SubmitBatcher.hpp"
+#include "Timing.hpp"
+#include "Trace.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPU worker threads produce each frame's data into a host-visible staging slot and publish it by signaling
+// a host timeline with vkSignalSemaphore. The submission that copies the slot to the GPU is made right after
+// the work is handed out and waits for that value (wait-before-signal), so the render thread never blocks on
+// the producers and the queue picks the data up as soon as it is signaled.
+class HostProducer
+{
+public:
+    void create(VkInstance instance,
+                VkDevice device,
+                VkPhysicalDevice physicalDevice,
+                MemoryArena& memoryArena,
+                uint32_t queueFamily,
+                uint32_t threadCount,
+                uint32_t framesInFlight,
+                bool calibratedTimestamps,
+                TraceRecorder& trace);
+    // The device must be idle so that every handed out frame has been signaled
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Hands the frame's data to a worker and adds the batch that copies it. The frame slot must be free, i.e.
+    // the sync strategy's waitForFrameSlot() has returned for it.
+    void submitFrame(SubmitBatcher& submits, uint32_t frameIndex);
+    // Adds the produce time and handoff latency of the frame slot's last frame once its copy has completed
+    void collectStats(uint32_t frameIndex, FrameStats& stats);
+
+private:
+    struct Job
+    {
+        uint32_t frameIndex;
+        uint64_t value;
+    };
+
+    struct SlotTiming
+    {
+        uint64_t produceNanoseconds = 0;
+        uint64_t signalNanoseconds = 0;
+        bool pending = false;
+    };
+
+    void workerLoop();
+    void produce(const Job& job);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    MemoryArena* m_memoryArena = nullptr;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    // Last value handed out by submitFrame(), only touched by the render thread
+    uint64_t m_value = 0;
+    std::vector<VkCommandPool> m_commandPools;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_stagingAllocation{};
+    VkBuffer m_deviceBuffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_deviceAllocation{};
+    GpuTimestamps m_timestamps;
+    TraceRecorder* m_trace = nullptr;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    // Workers finish out of order but timeline values must be signaled in increasing order
+    std::condition_variable m_signalOrder;
+    std::deque<Job> m_jobs;
+    uint64_t m_signaledValue = 0;
+    std::vector<SlotTiming> m_slotTimings;
+    bool m_stopping = false;
+};
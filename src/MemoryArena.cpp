@@ -0,0 +1,339 @@
+#include "MemoryArena.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+
+namespace
+{
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+void MemoryArena::create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize blockSize)
+{
+    m_device = device;
+    m_blockSize = blockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    m_frameArenas.resize(framesInFlight);
+}
+
+void MemoryArena::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    // Freeing the memory unmaps it too
+    for (const Block& block : m_blocks)
+    {
+        vkFreeMemory(m_device, block.memory, nullptr);
+    }
+
+    m_blocks.clear();
+    m_frameArenas.clear();
+    m_bytesInUse = 0;
+    m_allocationCount = 0;
+    m_device = VK_NULL_HANDLE;
+}
+
+MemoryArena::Allocation MemoryArena::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Tiling tiling)
+{
+    const uint32_t memoryType = findMemoryType(requirements, properties);
+    const VkDeviceSize align = alignment(requirements, memoryType);
+    const VkDeviceSize size = alignUp(requirements.size, align);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // First fit over the blocks in creation order, which keeps the older blocks full and the newer ones empty
+    for (uint32_t i = 0; i < ui32Size(m_blocks); ++i)
+    {
+        Block& block = m_blocks[i];
+        if (block.memoryType != memoryType || block.tiling != tiling)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < block.freeRanges.size(); ++j)
+        {
+            Range& range = block.freeRanges[j];
+            const VkDeviceSize offset = alignUp(range.offset, align);
+            const VkDeviceSize end = range.offset + range.size;
+            if (offset + size > end)
+            {
+                continue;
+            }
+
+            // The range splits in two if alignment leaves a gap in front
+            if (offset + size == end)
+            {
+                range.size = offset - range.offset;
+            }
+            else if (offset == range.offset)
+            {
+                range.offset = offset + size;
+                range.size = end - range.offset;
+            }
+            else
+            {
+                const Range tail{offset + size, end - offset - size};
+                range.size = offset - range.offset;
+                block.freeRanges.insert(block.freeRanges.begin() + j + 1, tail);
+            }
+
+            if (block.freeRanges[j].size == 0)
+            {
+                block.freeRanges.erase(block.freeRanges.begin() + j);
+            }
+
+            m_bytesInUse += size;
+            ++m_allocationCount;
+            return Allocation{block.memory, offset, size, i, block.data != nullptr ? block.data + offset : nullptr};
+        }
+    }
+
+    const uint32_t blockIndex = createBlock(memoryType, tiling, size, false);
+    Block& block = m_blocks[blockIndex];
+    block.freeRanges.clear();
+    if (size < block.size)
+    {
+        block.freeRanges.push_back(Range{size, block.size - size});
+    }
+
+    m_bytesInUse += size;
+    ++m_allocationCount;
+    return Allocation{block.memory, 0, size, blockIndex, block.data};
+}
+
+void MemoryArena::free(const Allocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE || allocation.block == c_transient)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Range>& ranges = m_blocks[allocation.block].freeRanges;
+    std::vector<Range>::iterator next = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, [](const Range& range, VkDeviceSize offset) {
+        return range.offset < offset;
+    });
+
+    // Merge with the free ranges on either side so that a fully freed block is a single range again
+    Range freed{allocation.offset, allocation.size};
+    if (next != ranges.end() && freed.offset + freed.size == next->offset)
+    {
+        freed.size += next->size;
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin())
+    {
+        std::vector<Range>::iterator previous = next - 1;
+        if (previous->offset + previous->size == freed.offset)
+        {
+            previous->size += freed.size;
+            freed.size = 0;
+        }
+    }
+    if (freed.size > 0)
+    {
+        ranges.insert(next, freed);
+    }
+
+    m_bytesInUse -= allocation.size;
+    --m_allocationCount;
+}
+
+MemoryArena::Allocation MemoryArena::allocateTransient(uint32_t frameIndex,
+                                                       const VkMemoryRequirements& requirements,
+                                                       VkMemoryPropertyFlags properties,
+                                                       Tiling tiling)
+{
+    const uint32_t memoryType = findMemoryType(requirements, properties);
+    const VkDeviceSize align = alignment(requirements, memoryType);
+    const VkDeviceSize size = alignUp(requirements.size, align);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<FrameArena>& arenas = m_frameArenas[frameIndex];
+    std::vector<FrameArena>::iterator arena = std::find_if(arenas.begin(), arenas.end(), [memoryType, tiling](const FrameArena& a) {
+        return a.memoryType == memoryType && a.tiling == tiling;
+    });
+    if (arena == arenas.end())
+    {
+        arenas.push_back(FrameArena{memoryType, tiling, {}, 0, 0, 0, 0});
+        arena = arenas.end() - 1;
+    }
+
+    // Moves on to the next block once the current one is full, the ones after it are left over from earlier frames
+    VkDeviceSize offset = alignUp(arena->offset, align);
+    while (arena->currentBlock < arena->blocks.size() && offset + size > m_blocks[arena->blocks[arena->currentBlock]].size)
+    {
+        ++arena->currentBlock;
+        offset = 0;
+    }
+    if (arena->currentBlock == arena->blocks.size())
+    {
+        arena->blocks.push_back(createBlock(memoryType, tiling, size, true));
+        offset = 0;
+    }
+
+    arena->offset = offset + size;
+    arena->bytesInUse += size;
+    ++arena->allocationCount;
+    m_bytesInUse += size;
+    ++m_allocationCount;
+    const Block& block = m_blocks[arena->blocks[arena->currentBlock]];
+    return Allocation{block.memory, offset, size, c_transient, block.data != nullptr ? block.data + offset : nullptr};
+}
+
+void MemoryArena::resetFrame(uint32_t frameIndex)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (FrameArena& arena : m_frameArenas[frameIndex])
+    {
+        m_bytesInUse -= arena.bytesInUse;
+        m_allocationCount -= arena.allocationCount;
+        arena.currentBlock = 0;
+        arena.offset = 0;
+        arena.bytesInUse = 0;
+        arena.allocationCount = 0;
+    }
+}
+
+MemoryArena::Allocation MemoryArena::createBuffer(VkDeviceSize size,
+                                                  VkBufferUsageFlags usage,
+                                                  VkMemoryPropertyFlags properties,
+                                                  VkBuffer& buffer,
+                                                  uint32_t frameIndex,
+                                                  uint32_t queueFamilyCount,
+                                                  const uint32_t* queueFamilies)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = queueFamilyCount > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    bufferInfo.queueFamilyIndexCount = queueFamilyCount > 1 ? queueFamilyCount : 0;
+    bufferInfo.pQueueFamilyIndices = queueFamilyCount > 1 ? queueFamilies : nullptr;
+    VK_CHECK(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer));
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memoryRequirements);
+
+    const Allocation allocation = frameIndex == c_transient ? allocate(memoryRequirements, properties, Tiling::Linear)
+                                                            : allocateTransient(frameIndex, memoryRequirements, properties, Tiling::Linear);
+    VK_CHECK(vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset));
+    return allocation;
+}
+
+void MemoryArena::destroyBuffer(VkBuffer buffer, const Allocation& allocation)
+{
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    free(allocation);
+}
+
+MemoryArena::Allocation MemoryArena::bindImage(VkImage image, VkMemoryPropertyFlags properties, uint32_t frameIndex)
+{
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memoryRequirements);
+
+    const Allocation allocation = frameIndex == c_transient ? allocate(memoryRequirements, properties, Tiling::Optimal)
+                                                            : allocateTransient(frameIndex, memoryRequirements, properties, Tiling::Optimal);
+    VK_CHECK(vkBindImageMemory(m_device, image, allocation.memory, allocation.offset));
+    return allocation;
+}
+
+MemoryArena::Stats MemoryArena::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats;
+    stats.blockCount = ui32Size(m_blocks);
+    stats.bytesInUse = m_bytesInUse;
+    stats.allocationCount = m_allocationCount;
+    for (const Block& block : m_blocks)
+    {
+        stats.blockBytes += block.size;
+        for (const Range& range : block.freeRanges)
+        {
+            stats.freeBytes += range.size;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, range.size);
+            ++stats.freeRangeCount;
+        }
+    }
+    return stats;
+}
+
+void MemoryArena::printStats()
+{
+    const Stats s = stats();
+    const double mib = 1024.0 * 1024.0;
+    printf("Memory arena: %u blocks, %.1f MiB, %.1f MiB in use by %llu allocations\n",
+           s.blockCount,
+           s.blockBytes / mib,
+           s.bytesInUse / mib,
+           static_cast<unsigned long long>(s.allocationCount));
+    printf("Memory arena free list: %.1f MiB in %u ranges, largest %.1f MiB, fragmentation %.1f%%\n",
+           s.freeBytes / mib,
+           s.freeRangeCount,
+           s.largestFreeRange / mib,
+           s.fragmentation() * 100.0);
+}
+
+uint32_t MemoryArena::findMemoryType(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((requirements.memoryTypeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    CHECK(!"No suitable memory type");
+    return 0;
+}
+
+VkDeviceSize MemoryArena::alignment(const VkMemoryRequirements& requirements, uint32_t memoryType) const
+{
+    const VkMemoryPropertyFlags flags = m_memoryProperties.memoryTypes[memoryType].propertyFlags;
+    const bool nonCoherent = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    return std::max(std::max<VkDeviceSize>(requirements.alignment, 1), nonCoherent ? m_nonCoherentAtomSize : 1);
+}
+
+uint32_t MemoryArena::createBlock(uint32_t memoryType, Tiling tiling, VkDeviceSize minSize, bool transient)
+{
+    // Resources larger than a block get a block of their own
+    Block block{VK_NULL_HANDLE, memoryType, tiling, std::max(m_blockSize, minSize), nullptr, {}};
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = block.size;
+    allocateInfo.memoryTypeIndex = memoryType;
+    VK_CHECK(vkAllocateMemory(m_device, &allocateInfo, nullptr, &block.memory));
+
+    // A memory object can only be mapped once, so the whole block is mapped for all of its allocations
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void* data = nullptr;
+        VK_CHECK(vkMapMemory(m_device, block.memory, 0, VK_WHOLE_SIZE, 0, &data));
+        block.data = static_cast<char*>(data);
+    }
+
+    if (!transient)
+    {
+        block.freeRanges.push_back(Range{0, block.size});
+    }
+
+    m_blocks.push_back(block);
+    return ui32Size(m_blocks) - 1;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Sub-allocates buffers and images from a few large vkAllocateMemory blocks per memory type instead of one
+// device allocation per resource, which runs into maxMemoryAllocationCount and makes resource creation slow.
+// Long-lived resources come from a first-fit free list per block that merges neighbouring ranges when freed.
+// Transient resources are bump allocated from blocks owned by a frame slot, and resetFrame() releases all of
+// them at once when the slot's last submission has completed. Host-visible blocks stay mapped for their whole
+// lifetime. Thread safe.
+class MemoryArena
+{
+public:
+    // Buffers and linear images never share a block with optimal images, so bufferImageGranularity doesn't
+    // have to pad between neighbours
+    enum class Tiling
+    {
+        Linear,
+        Optimal
+    };
+
+    struct Allocation
+    {
+        VkDeviceMemory memory;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        // Block of a long-lived allocation, c_transient for one released by resetFrame()
+        uint32_t block;
+        // Host address of offset, null unless the memory is host visible
+        char* data;
+    };
+
+    struct Stats
+    {
+        uint32_t blockCount = 0;
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize bytesInUse = 0;
+        uint64_t allocationCount = 0;
+        // Free space between long-lived allocations, in how many ranges and the largest of them
+        VkDeviceSize freeBytes = 0;
+        uint32_t freeRangeCount = 0;
+        VkDeviceSize largestFreeRange = 0;
+
+        // Share of the free space that a single allocation can't use, 0 when it is all in one range
+        double fragmentation() const { return freeBytes > 0 ? 1.0 - static_cast<double>(largestFreeRange) / freeBytes : 0.0; }
+    };
+
+    static const uint32_t c_transient = UINT32_MAX;
+    static const VkDeviceSize c_defaultBlockSize = 64 * 1024 * 1024;
+
+    void create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize blockSize = c_defaultBlockSize);
+    // Every resource bound to the arena must have been destroyed
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Tiling tiling);
+    void free(const Allocation& allocation);
+    // Valid until resetFrame() for the same frame slot
+    Allocation allocateTransient(uint32_t frameIndex, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Tiling tiling);
+    // The frame slot's resources must have been destroyed, i.e. its last submission has completed
+    void resetFrame(uint32_t frameIndex);
+
+    // Creates the buffer and binds memory to it, transient if frameIndex is given. The buffer is shared by the
+    // queue families without ownership transfers if more than one is given.
+    Allocation createBuffer(VkDeviceSize size,
+                            VkBufferUsageFlags usage,
+                            VkMemoryPropertyFlags properties,
+                            VkBuffer& buffer,
+                            uint32_t frameIndex = c_transient,
+                            uint32_t queueFamilyCount = 0,
+                            const uint32_t* queueFamilies = nullptr);
+    // Frees the allocation too, which must not be transient
+    void destroyBuffer(VkBuffer buffer, const Allocation& allocation);
+    // For optimal tiling images
+    Allocation bindImage(VkImage image, VkMemoryPropertyFlags properties, uint32_t frameIndex = c_transient);
+
+    Stats stats();
+    void printStats();
+
+private:
+    struct Range
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block
+    {
+        VkDeviceMemory memory;
+        uint32_t memoryType;
+        Tiling tiling;
+        VkDeviceSize size;
+        char* data;
+        // Sorted by offset and never adjacent, empty for transient blocks
+        std::vector<Range> freeRanges;
+    };
+
+    // Bump allocator of one frame slot and memory type, which reuses its blocks after every reset
+    struct FrameArena
+    {
+        uint32_t memoryType;
+        Tiling tiling;
+        std::vector<uint32_t> blocks;
+        size_t currentBlock;
+        VkDeviceSize offset;
+        VkDeviceSize bytesInUse;
+        uint64_t allocationCount;
+    };
+
+    uint32_t findMemoryType(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) const;
+    // Non-coherent memory is also aligned to nonCoherentAtomSize, so that every allocation can be flushed and
+    // invalidated on its own
+    VkDeviceSize alignment(const VkMemoryRequirements& requirements, uint32_t memoryType) const;
+    uint32_t createBlock(uint32_t memoryType, Tiling tiling, VkDeviceSize minSize, bool transient);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_blockSize = c_defaultBlockSize;
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+
+    std::mutex m_mutex;
+    std::vector<Block> m_blocks;
+    std::vector<std::vector<FrameArena>> m_frameArenas;
+    VkDeviceSize m_bytesInUse = 0;
+    uint64_t m_allocationCount = 0;
+};
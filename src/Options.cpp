@@ -0,0 +1,383 @@
+#include "Options.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+const RecordMode c_recordModes[] = {RecordMode::Reset, RecordMode::Release, RecordMode::Cache};
+// Readback ring size when only --capture is given
+const uint32_t c_defaultReadbackSlots = 4;
+const VkPresentModeKHR c_presentModes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+
+void printUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --frames-in-flight <n>  Frames the CPU may record ahead of the GPU (default 2)\n");
+    printf("  --headless              Render into offscreen images, no window or vsync\n");
+    printf("  --device <index|name>   Physical device by index or part of its name (default 0)\n");
+    printf("  --all-devices           Drive every device concurrently from its own thread, implies --headless\n");
+    printf("  --frames <n>            Stop after n frames (headless default 1000)\n");
+    printf("  --duration <seconds>    Stop after the given time\n");
+    printf("  --stats <file>          Export phase latency percentiles as JSON (.json) or CSV\n");
+    printf("  --results <file>        Export throughput and p99 of each run or stress configuration as JSON\n");
+    printf("  --trace <file>          Write a Chrome/Perfetto trace of CPU phases, GPU work and timeline values\n");
+    printf("  --sync <strategy>       Frame pacing: fence, binary or timeline (default timeline)\n");
+    printf("  --benchmark             Run all sync strategies and print a comparison\n");
+    printf("  --pace                  Compare each run with a paced one that starts frames just in time\n");
+    printf("  --async-compute <depth> Compute queue work that graphics consumes depth frames later (timeline only)\n");
+    printf("  --host-producers <n>    Worker threads producing per-frame data signaled from the host (timeline only)\n");
+    printf("  --reactor               Retire deletions from a thread waiting on all timeline values (timeline only)\n");
+    printf("  --submit-thread         Submit and present on a thread fed through a lock-free ring (timeline only)\n");
+    printf("  --record-threads <n>    Record the render pass on n threads into secondary command buffers\n");
+    printf("  --clears <n>            Clear commands each record thread issues per frame (default 1000)\n");
+    printf("  --commands <mode>       Command buffers: reset, release or cache (default reset)\n");
+    printf("  --legacy-submit         Use vkQueueSubmit instead of vkQueueSubmit2\n");
+    printf("  --present-mode <mode>   fifo, fifo-relaxed, mailbox or immediate (default fifo)\n");
+    printf("  --gpu-dispatches <n>    Synthetic compute dispatches per frame\n");
+    printf("  --gpu-draws <n>         Synthetic full-screen draws per frame\n");
+    printf("  --gpu-iterations <n>    ALU loop iterations per compute element or pixel (default 64)\n");
+    printf("  --gpu-resolution <WxH>  Elements each compute dispatch processes (default 1024x1024)\n");
+    printf("  --upload <MB>           Stream MB per frame through a staging ring buffer\n");
+    printf("  --readback <n>          Copy frames into a ring of n host buffers and checksum them\n");
+    printf("  --capture <directory>   Write read back frames to directory as PPM files\n");
+    printf("  --semaphore-stress <n>  Benchmark up to n timeline semaphores instead of rendering\n");
+    printf("  --stress-depth <n>      Longest batch chain of the semaphore stress benchmark (default 64)\n");
+    printf("  --frame-graph <width>   Benchmark random pass graphs up to width passes wide on two queues\n");
+    printf("  --memory-arena <n>      Benchmark binding n transient resources per frame from the memory arena\n");
+    printf("  --share-timeline <role> Share the timeline with another process as producer or consumer\n");
+    printf("  --socket <path>         Socket the shared timeline is passed over (default /tmp/timeline-test.sock)\n");
+    printf("  --help                  Show this message\n");
+}
+
+[[noreturn]] void failUsage(const char* program, const char* message, const char* arg)
+{
+    printf("%s: %s\n\n", message, arg);
+    printUsage(program);
+    exit(EXIT_FAILURE);
+}
+
+const char* nextValue(int argc, char** argv, int& i)
+{
+    if (i + 1 >= argc)
+    {
+        failUsage(argv[0], "Missing value for option", argv[i]);
+    }
+    return argv[++i];
+}
+
+uint64_t parseUnsigned(const char* program, const char* value, uint64_t minValue)
+{
+    char* end = nullptr;
+    const unsigned long long parsed = strtoull(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < minValue)
+    {
+        failUsage(program, "Invalid value", value);
+    }
+    return parsed;
+}
+
+VkExtent2D parseExtent(const char* program, const char* value)
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    char trailing = '\0';
+    if (sscanf(value, "%ux%u%c", &width, &height, &trailing) != 2 || width == 0 || height == 0)
+    {
+        failUsage(program, "Invalid resolution", value);
+    }
+    return {width, height};
+}
+
+double parseSeconds(const char* program, const char* value)
+{
+    char* end = nullptr;
+    const double parsed = strtod(value, &end);
+    if (end == value || *end != '\0' || !(parsed > 0.0))
+    {
+        failUsage(program, "Invalid value", value);
+    }
+    return parsed;
+}
+} // namespace
+
+const char* recordModeName(RecordMode mode)
+{
+    switch (mode)
+    {
+    case RecordMode::Reset:
+        return "reset";
+    case RecordMode::Release:
+        return "release";
+    case RecordMode::Cache:
+        return "cache";
+    default:
+        return "unknown";
+    }
+}
+
+const char* presentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    default:
+        return "unknown";
+    }
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--frames-in-flight") == 0)
+        {
+            options.framesInFlight = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if (strcmp(arg, "--device") == 0)
+        {
+            options.device = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--all-devices") == 0)
+        {
+            options.allDevices = true;
+            options.headless = true;
+        }
+        else if (strcmp(arg, "--frames") == 0)
+        {
+            options.frameCount = parseUnsigned(argv[0], nextValue(argc, argv, i), 1);
+        }
+        else if (strcmp(arg, "--duration") == 0)
+        {
+            options.durationSeconds = parseSeconds(argv[0], nextValue(argc, argv, i));
+        }
+        else if (strcmp(arg, "--stats") == 0)
+        {
+            options.statsPath = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--results") == 0)
+        {
+            options.resultsPath = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--trace") == 0)
+        {
+            options.tracePath = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--sync") == 0)
+        {
+            const char* value = nextValue(argc, argv, i);
+            if (!parseSyncStrategy(value, options.syncStrategy))
+            {
+                failUsage(argv[0], "Unknown sync strategy", value);
+            }
+        }
+        else if (strcmp(arg, "--benchmark") == 0)
+        {
+            options.benchmark = true;
+        }
+        else if (strcmp(arg, "--pace") == 0)
+        {
+            options.pace = true;
+        }
+        else if (strcmp(arg, "--async-compute") == 0)
+        {
+            options.asyncCompute = true;
+            options.asyncComputeDepth = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 0));
+        }
+        else if (strcmp(arg, "--host-producers") == 0)
+        {
+            options.hostProducerThreads = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--reactor") == 0)
+        {
+            options.completionReactor = true;
+        }
+        else if (strcmp(arg, "--submit-thread") == 0)
+        {
+            options.submitThread = true;
+        }
+        else if (strcmp(arg, "--record-threads") == 0)
+        {
+            options.recordThreads = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--clears") == 0)
+        {
+            options.clearsPerRecordThread = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 0));
+        }
+        else if (strcmp(arg, "--commands") == 0)
+        {
+            const char* value = nextValue(argc, argv, i);
+            bool found = false;
+            for (RecordMode mode : c_recordModes)
+            {
+                if (strcmp(value, recordModeName(mode)) == 0)
+                {
+                    options.recordMode = mode;
+                    found = true;
+                }
+            }
+            if (!found)
+            {
+                failUsage(argv[0], "Unknown command buffer mode", value);
+            }
+        }
+        else if (strcmp(arg, "--legacy-submit") == 0)
+        {
+            options.legacySubmit = true;
+        }
+        else if (strcmp(arg, "--gpu-dispatches") == 0)
+        {
+            options.gpuDispatches = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 0));
+        }
+        else if (strcmp(arg, "--gpu-draws") == 0)
+        {
+            options.gpuDraws = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 0));
+        }
+        else if (strcmp(arg, "--gpu-iterations") == 0)
+        {
+            options.gpuIterations = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 0));
+        }
+        else if (strcmp(arg, "--gpu-resolution") == 0)
+        {
+            options.gpuResolution = parseExtent(argv[0], nextValue(argc, argv, i));
+        }
+        else if (strcmp(arg, "--upload") == 0)
+        {
+            options.uploadMegabytes = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--readback") == 0)
+        {
+            options.readbackSlots = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--capture") == 0)
+        {
+            options.capturePath = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--semaphore-stress") == 0)
+        {
+            options.stressSemaphores = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--stress-depth") == 0)
+        {
+            options.stressDepth = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--frame-graph") == 0)
+        {
+            options.frameGraphWidth = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--memory-arena") == 0)
+        {
+            options.arenaResources = static_cast<uint32_t>(parseUnsigned(argv[0], nextValue(argc, argv, i), 1));
+        }
+        else if (strcmp(arg, "--share-timeline") == 0)
+        {
+            const char* value = nextValue(argc, argv, i);
+            if (strcmp(value, "producer") != 0 && strcmp(value, "consumer") != 0)
+            {
+                failUsage(argv[0], "Unknown timeline share role", value);
+            }
+            options.shareTimeline = value;
+            options.headless = true;
+        }
+        else if (strcmp(arg, "--socket") == 0)
+        {
+            options.socketPath = nextValue(argc, argv, i);
+        }
+        else if (strcmp(arg, "--present-mode") == 0)
+        {
+            const char* value = nextValue(argc, argv, i);
+            bool found = false;
+            for (VkPresentModeKHR mode : c_presentModes)
+            {
+                if (strcmp(value, presentModeName(mode)) == 0)
+                {
+                    options.presentMode = mode;
+                    found = true;
+                }
+            }
+            if (!found)
+            {
+                failUsage(argv[0], "Unknown present mode", value);
+            }
+        }
+        else if (strcmp(arg, "--help") == 0)
+        {
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            failUsage(argv[0], "Unknown option", arg);
+        }
+    }
+
+    if (options.asyncCompute && !options.benchmark && options.syncStrategy != SyncStrategy::Timeline)
+    {
+        failUsage(argv[0], "Async compute needs the timeline strategy, got", syncStrategyName(options.syncStrategy));
+    }
+    if (options.recordMode == RecordMode::Cache && options.recordThreads > 0)
+    {
+        failUsage(argv[0], "Cached command buffers can not be combined with", "--record-threads");
+    }
+    if (options.gpuDraws > 0 && options.recordThreads > 0)
+    {
+        failUsage(argv[0], "Full-screen draws can not be combined with", "--record-threads");
+    }
+    if (options.recordMode == RecordMode::Cache && options.uploadMegabytes > 0)
+    {
+        failUsage(argv[0], "Cached command buffers can not be combined with", "--upload");
+    }
+    if (options.hostProducerThreads > 0 && !options.benchmark && options.syncStrategy != SyncStrategy::Timeline)
+    {
+        failUsage(argv[0], "Host producers need the timeline strategy, got", syncStrategyName(options.syncStrategy));
+    }
+    if (options.completionReactor && !options.benchmark && options.syncStrategy != SyncStrategy::Timeline)
+    {
+        failUsage(argv[0], "The completion reactor needs the timeline strategy, got", syncStrategyName(options.syncStrategy));
+    }
+    if (options.submitThread && !options.benchmark && options.syncStrategy != SyncStrategy::Timeline)
+    {
+        failUsage(argv[0], "The submit thread needs the timeline strategy, got", syncStrategyName(options.syncStrategy));
+    }
+    if (options.submitThread && options.asyncCompute)
+    {
+        failUsage(argv[0], "The submit thread can not be combined with", "--async-compute");
+    }
+    if (options.submitThread && options.hostProducerThreads > 0)
+    {
+        failUsage(argv[0], "The submit thread can not be combined with", "--host-producers");
+    }
+    if (!options.capturePath.empty() && options.readbackSlots == 0)
+    {
+        options.readbackSlots = c_defaultReadbackSlots;
+    }
+    if (options.readbackSlots > 0 && !options.benchmark && options.syncStrategy != SyncStrategy::Timeline)
+    {
+        failUsage(argv[0], "Readback needs the timeline strategy, got", syncStrategyName(options.syncStrategy));
+    }
+    if (options.readbackSlots > 0 && options.recordMode == RecordMode::Cache)
+    {
+        failUsage(argv[0], "Cached command buffers can not be combined with", "--readback");
+    }
+
+    // A headless run has no window to close, so make sure it terminates
+    if (options.headless && options.frameCount == 0 && options.durationSeconds == 0.0)
+    {
+        options.frameCount = 1000;
+    }
+    return options;
+}
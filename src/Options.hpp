@@ -0,0 +1,100 @@
+#pragma once
+
+#include "SyncStrategy.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// How the frame's primary command buffer is produced
+enum class RecordMode
+{
+    // Reset the frame slot's command pool and record again
+    Reset,
+    // The same, but the pool also releases its memory back to the driver every frame
+    Release,
+    // Record once per frame slot and framebuffer and resubmit while the framebuffer and clear value are unchanged
+    Cache
+};
+
+const char* recordModeName(RecordMode mode);
+const char* presentModeName(VkPresentModeKHR mode);
+
+struct Options
+{
+    // Number of frames the CPU may record ahead of the GPU
+    uint32_t framesInFlight = 2;
+    // Render into offscreen images without GLFW, a surface or a swapchain
+    bool headless = false;
+    // Index or part of the name of the physical device to use, the first one if empty
+    std::string device;
+    // Run a headless frame loop on every device concurrently, one thread each, instead of rendering
+    bool allDevices = false;
+    // Stop after this many frames, 0 for no limit
+    uint64_t frameCount = 0;
+    // Stop after this many seconds, 0 for no limit
+    double durationSeconds = 0.0;
+    // Write per-phase latency percentiles here at exit, JSON for a .json extension and CSV otherwise
+    std::string statsPath;
+    // Write the throughput and p99 of each run or semaphore stress configuration here as JSON, read by the CTest
+    // benchmarks
+    std::string resultsPath;
+    // Write a Chrome Trace Event JSON file of the CPU phases, GPU work and timeline values here at exit
+    std::string tracePath;
+    SyncStrategy syncStrategy = SyncStrategy::Timeline;
+    // Run every supported strategy one after another and compare them
+    bool benchmark = false;
+    // Run each strategy without and then with the frame pacer and compare latency and frame rate
+    bool pace = false;
+    // Run per-frame work on the compute queue that graphics waits for asyncComputeDepth frames later.
+    // Needs the timeline strategy.
+    bool asyncCompute = false;
+    uint32_t asyncComputeDepth = 1;
+    // CPU worker threads that produce per-frame data and signal it with vkSignalSemaphore, 0 to disable.
+    // Needs the timeline strategy.
+    uint32_t hostProducerThreads = 0;
+    // Retire deferred deletions from a completion reactor thread instead of polling the timeline every frame.
+    // Needs the timeline strategy.
+    bool completionReactor = false;
+    // Make the queue submissions and presents on a dedicated thread fed by the main thread through a lock-free
+    // ring. Needs the timeline strategy and can't be combined with async compute or host producers.
+    bool submitThread = false;
+    // Threads recording the render pass into secondary command buffers, 0 to record inline on the main thread
+    uint32_t recordThreads = 0;
+    // Synthetic clear commands each record thread issues per frame
+    uint32_t clearsPerRecordThread = 1000;
+    RecordMode recordMode = RecordMode::Reset;
+    // Submit with vkQueueSubmit even if VK_KHR_synchronization2 is available
+    bool legacySubmit = false;
+    // Run the timeline semaphore stress benchmark up to this many semaphores instead of rendering, 0 to render
+    uint32_t stressSemaphores = 0;
+    // Longest chain of dependent batches the stress benchmark submits at once
+    uint32_t stressDepth = 64;
+    // Benchmark random frame graphs up to this many passes wide instead of rendering, 0 to disable
+    uint32_t frameGraphWidth = 0;
+    // Benchmark sub-allocating this many transient resources per frame from the memory arena instead of
+    // rendering, 0 to disable
+    uint32_t arenaResources = 0;
+    // Synthetic GPU load: compute dispatches before the render pass and full-screen draws inside it, each running
+    // gpuIterations of an ALU loop per element or pixel. Compute processes gpuResolution elements per dispatch.
+    uint32_t gpuDispatches = 0;
+    uint32_t gpuDraws = 0;
+    uint32_t gpuIterations = 64;
+    VkExtent2D gpuResolution{1024, 1024};
+    // Megabytes streamed to the GPU through the upload ring every frame, 0 to disable
+    uint32_t uploadMegabytes = 0;
+    // Host buffers frames are read back into for checksumming, 0 to disable
+    uint32_t readbackSlots = 0;
+    // Directory the read back frames are written to, empty to only checksum them
+    std::string capturePath;
+    // Share the frame timeline with a second process as "producer" or "consumer" and measure the handoffs
+    // instead of rendering, empty to render
+    std::string shareTimeline;
+    // Unix domain socket the semaphore's fd is passed over
+    std::string socketPath = "/tmp/timeline-test.sock";
+    // Requested swapchain present mode, FIFO is used if the surface doesn't support it
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+};
+
+Options parseOptions(int argc, char** argv);
@@ -0,0 +1,168 @@
+#include "ParallelRecorder.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+
+void ParallelRecorder::create(VkDevice device,
+                              uint32_t queueFamily,
+                              VkRenderPass renderPass,
+                              uint32_t threadCount,
+                              uint32_t framesInFlight,
+                              uint32_t clearsPerThread)
+{
+    m_device = device;
+    m_renderPass = renderPass;
+    m_threadCount = threadCount;
+    m_clearsPerThread = clearsPerThread;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_commandPools.resize(framesInFlight * threadCount);
+    m_commandBuffers.resize(framesInFlight * threadCount);
+    for (size_t i = 0; i < m_commandPools.size(); ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPools[i]));
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffers[i]));
+    }
+
+    m_generation = 0;
+    m_stopping = false;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_workers.push_back(std::thread(&ParallelRecorder::workerLoop, this, i));
+    }
+}
+
+void ParallelRecorder::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_frameStarted.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    for (const VkCommandPool& commandPool : m_commandPools)
+    {
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
+    }
+    m_device = VK_NULL_HANDLE;
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex, VkFramebuffer framebuffer, VkExtent2D extent)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameIndex = frameIndex;
+        m_framebuffer = framebuffer;
+        m_extent = extent;
+        m_remaining = m_threadCount;
+        ++m_generation;
+    }
+    m_frameStarted.notify_all();
+}
+
+void ParallelRecorder::cmdExecute(VkCommandBuffer cb, uint32_t frameIndex)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_frameRecorded.wait(lock, [this] { return m_remaining == 0; });
+    }
+    vkCmdExecuteCommands(cb, m_threadCount, &m_commandBuffers[frameIndex * m_threadCount]);
+}
+
+void ParallelRecorder::workerLoop(uint32_t threadIndex)
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        uint32_t frameIndex;
+        VkFramebuffer framebuffer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameStarted.wait(lock, [this, generation] { return m_stopping || m_generation != generation; });
+            if (m_stopping)
+            {
+                return;
+            }
+            generation = m_generation;
+            frameIndex = m_frameIndex;
+            framebuffer = m_framebuffer;
+        }
+
+        record(threadIndex, frameIndex, framebuffer);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            last = --m_remaining == 0;
+        }
+        if (last)
+        {
+            m_frameRecorded.notify_one();
+        }
+    }
+}
+
+void ParallelRecorder::record(uint32_t threadIndex, uint32_t frameIndex, VkFramebuffer framebuffer)
+{
+    const uint32_t index = frameIndex * m_threadCount + threadIndex;
+    VkCommandBuffer cb = m_commandBuffers[index];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VK_CHECK(vkResetCommandPool(m_device, m_commandPools[index], 0));
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
+
+    // Each thread clears small tiles in its own horizontal band, one command per "draw"
+    const uint32_t bandHeight = m_extent.height / m_threadCount > 0 ? m_extent.height / m_threadCount : 1;
+    // Resizing can make the window smaller than a tile
+    const uint32_t tileSize = std::min(8u, std::min(m_extent.width, m_extent.height));
+    const uint32_t tilesPerRow = std::max(m_extent.width / tileSize, 1u);
+    const uint32_t rowRange = std::max(m_extent.height - tileSize, 1u);
+    for (uint32_t i = 0; i < m_clearsPerThread; ++i)
+    {
+        VkClearAttachment attachment{};
+        attachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        attachment.colorAttachment = 0;
+        attachment.clearValue.color = {{static_cast<float>(threadIndex) / m_threadCount, static_cast<float>(i % 256) / 255.0f, 0.2f, 1.0f}};
+
+        VkClearRect rect{};
+        rect.rect.offset.x = static_cast<int32_t>((i % tilesPerRow) * tileSize);
+        rect.rect.offset.y = static_cast<int32_t>((threadIndex * bandHeight + (i / tilesPerRow) * tileSize) % rowRange);
+        rect.rect.extent = {tileSize, tileSize};
+        rect.baseArrayLayer = 0;
+        rect.layerCount = 1;
+
+        vkCmdClearAttachments(cb, 1, &attachment, 1, &rect);
+    }
+
+    VK_CHECK(vkEndCommandBuffer(cb));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records the frame's render pass contents as one secondary command buffer per worker thread. Every worker
+// has its own command pool per frame in flight so that recording needs no locking, and each records a
+// synthetic number of clears to stand in for draw calls.
+class ParallelRecorder
+{
+public:
+    void create(VkDevice device,
+                uint32_t queueFamily,
+                VkRenderPass renderPass,
+                uint32_t threadCount,
+                uint32_t framesInFlight,
+                uint32_t clearsPerThread);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Starts the workers on the frame slot's secondary command buffers. The frame slot must be free. The extent
+    // is the framebuffer's, which changes when the swapchain is recreated.
+    void beginFrame(uint32_t frameIndex, VkFramebuffer framebuffer, VkExtent2D extent);
+    // Waits for the workers and executes their command buffers. Must be called inside the render pass begun
+    // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    void cmdExecute(VkCommandBuffer cb, uint32_t frameIndex);
+
+private:
+    void workerLoop(uint32_t threadIndex);
+    void record(uint32_t threadIndex, uint32_t frameIndex, VkFramebuffer framebuffer);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkExtent2D m_extent{};
+    uint32_t m_threadCount = 0;
+    uint32_t m_clearsPerThread = 0;
+    // Indexed by frameIndex * m_threadCount + threadIndex
+    std::vector<VkCommandPool> m_commandPools;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_frameStarted;
+    std::condition_variable m_frameRecorded;
+    // Bumped for every frame so that each worker records it exactly once
+    uint64_t m_generation = 0;
+    uint32_t m_frameIndex = 0;
+    VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+    uint32_t m_remaining = 0;
+    bool m_stopping = false;
+};
@@ -0,0 +1,102 @@
+#include "PresentWaiter.hpp"
+#include "Common.hpp"
+
+namespace
+{
+// Bounded so that a present that never completes, e.g. on a swapchain that was just replaced, can't hang
+// waitProcessed()
+const uint64_t c_presentWaitTimeout = 1000000000;
+} // namespace
+
+void PresentWaiter::create(VkDevice device, TraceRecorder& trace)
+{
+    m_trace = &trace;
+    m_vkWaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+    CHECK(m_vkWaitForPresent);
+    m_device = device;
+    m_stopping = false;
+    m_worker = std::thread(&PresentWaiter::workerLoop, this);
+}
+
+void PresentWaiter::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_presentAdded.notify_one();
+    m_worker.join();
+    m_presents.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void PresentWaiter::add(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t submitNanoseconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_presents.push_back({swapchain, presentId, submitNanoseconds});
+    }
+    m_presentAdded.notify_one();
+}
+
+void PresentWaiter::waitProcessed(uint64_t presentId)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_presentProcessed.wait(lock, [this, presentId] { return m_processedId >= presentId; });
+}
+
+bool PresentWaiter::isProcessed(uint64_t presentId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_processedId >= presentId;
+}
+
+void PresentWaiter::collect(LatencyHistogram& histogram)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    histogram = m_latencies;
+    m_latencies.reset();
+}
+
+void PresentWaiter::workerLoop()
+{
+    m_trace->nameThread("present waiter");
+    for (;;)
+    {
+        Present present;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_presentAdded.wait(lock, [this] { return m_stopping || !m_presents.empty(); });
+            if (m_stopping)
+            {
+                return;
+            }
+            present = m_presents.front();
+            m_presents.pop_front();
+        }
+
+        const uint64_t waitNanoseconds = hostNanoseconds();
+        const VkResult result = m_vkWaitForPresent(m_device, present.swapchain, present.presentId, c_presentWaitTimeout);
+        const uint64_t presentedNanoseconds = hostNanoseconds();
+        m_trace->span("present wait", waitNanoseconds, presentedNanoseconds);
+        if (result != VK_TIMEOUT && result != VK_ERROR_OUT_OF_DATE_KHR && result != VK_SUBOPTIMAL_KHR)
+        {
+            VK_CHECK(result);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+            {
+                m_latencies.add(presentedNanoseconds - present.submitNanoseconds);
+            }
+            m_processedId = present.presentId;
+        }
+        m_presentProcessed.notify_all();
+    }
+}
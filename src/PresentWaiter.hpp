@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Timing.hpp"
+#include "Trace.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Waits for presents with VK_KHR_present_wait on its own thread and records the latency from each frame's
+// queue submission until the presentation engine reported it as presented
+class PresentWaiter
+{
+public:
+    void create(VkDevice device, TraceRecorder& trace);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // presentId must increase with every call
+    void add(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t submitNanoseconds);
+    // Blocks until the waiter is done with every present up to presentId, e.g. before its swapchain is destroyed
+    void waitProcessed(uint64_t presentId);
+    bool isProcessed(uint64_t presentId);
+    // Moves the latencies recorded so far into histogram
+    void collect(LatencyHistogram& histogram);
+
+private:
+    struct Present
+    {
+        VkSwapchainKHR swapchain;
+        uint64_t presentId;
+        uint64_t submitNanoseconds;
+    };
+
+    void workerLoop();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    PFN_vkWaitForPresentKHR m_vkWaitForPresent = nullptr;
+    TraceRecorder* m_trace = nullptr;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_presentAdded;
+    std::condition_variable m_presentProcessed;
+    std::deque<Present> m_presents;
+    uint64_t m_processedId = 0;
+    LatencyHistogram m_latencies;
+    bool m_stopping = false;
+};
@@ -0,0 +1,255 @@
+#include "SemaphoreStress.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+// Batches per vkQueueSubmit call, chains longer than this take several calls
+const uint32_t c_batchesPerSubmit = 64;
+const uint32_t c_wakeUpSamples = 100;
+// Time given to the waiter to block in vkWaitSemaphores before the host signals
+const std::chrono::microseconds c_signalDelay(200);
+} // namespace
+
+void SemaphoreStress::create(VkDevice device, VkQueue queue)
+{
+    m_device = device;
+    m_queue = queue;
+}
+
+void SemaphoreStress::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    destroySemaphores();
+    m_device = VK_NULL_HANDLE;
+}
+
+SemaphoreStress::Result SemaphoreStress::run(uint32_t semaphoreCount, uint32_t chainDepth, double seconds)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    createSemaphores(semaphoreCount);
+
+    Result result;
+    result.semaphoreCount = semaphoreCount;
+    result.chainDepth = chainDepth;
+
+    // The host waits for every signal of the previous chain, which is at most one per semaphore
+    const uint32_t tailCount = std::min(chainDepth, semaphoreCount);
+    std::vector<VkSemaphore> tailSemaphores;
+    std::vector<uint64_t> tailValues;
+
+    uint64_t submitCount = 0;
+    uint64_t signalCount = 0;
+    const Clock::time_point startTime = Clock::now();
+    double elapsedSeconds = 0.0;
+    while (elapsedSeconds < seconds)
+    {
+        submitCount += submitChain(chainDepth);
+        signalCount += chainDepth;
+
+        // Keeps one chain queued behind the one being waited for so the queue never runs dry
+        if (!tailSemaphores.empty())
+        {
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = ui32Size(tailSemaphores);
+            waitInfo.pSemaphores = tailSemaphores.data();
+            waitInfo.pValues = tailValues.data();
+            VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+        }
+
+        tailSemaphores.clear();
+        tailValues.clear();
+        for (uint32_t i = 0; i < tailCount; ++i)
+        {
+            const uint32_t index = (m_cursor + semaphoreCount - tailCount + i) % semaphoreCount;
+            tailSemaphores.push_back(m_semaphores[index]);
+            tailValues.push_back(m_values[index]);
+        }
+        elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    }
+
+    VK_CHECK(vkQueueWaitIdle(m_queue));
+    elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    result.submitsPerSecond = submitCount / elapsedSeconds;
+    result.signalsPerSecond = signalCount / elapsedSeconds;
+
+    measureWakeUps(result);
+    destroySemaphores();
+    return result;
+}
+
+void SemaphoreStress::printResults(const std::vector<Result>& results)
+{
+    printf("\n%10s %6s %12s %12s %14s %14s %14s %14s\n",
+           "semaphores",
+           "depth",
+           "submits/s",
+           "signals/s",
+           "all p50 us",
+           "all p99 us",
+           "any p50 us",
+           "any p99 us");
+    for (const Result& result : results)
+    {
+        printf("%10u %6u %12.0f %12.0f %14.2f %14.2f %14.2f %14.2f\n",
+               result.semaphoreCount,
+               result.chainDepth,
+               result.submitsPerSecond,
+               result.signalsPerSecond,
+               result.waitAll.percentile(50.0) / 1000.0,
+               result.waitAll.percentile(99.0) / 1000.0,
+               result.waitAny.percentile(50.0) / 1000.0,
+               result.waitAny.percentile(99.0) / 1000.0);
+    }
+}
+
+void SemaphoreStress::createSemaphores(uint32_t count)
+{
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &timelineCreateInfo;
+
+    m_semaphores.resize(count);
+    m_values.assign(count, 0);
+    m_cursor = 0;
+    for (VkSemaphore& semaphore : m_semaphores)
+    {
+        VK_CHECK(vkCreateSemaphore(m_device, &createInfo, nullptr, &semaphore));
+    }
+}
+
+void SemaphoreStress::destroySemaphores()
+{
+    for (const VkSemaphore& semaphore : m_semaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    m_semaphores.clear();
+    m_values.clear();
+}
+
+uint32_t SemaphoreStress::submitChain(uint32_t chainDepth)
+{
+    std::array<VkSubmitInfo, c_batchesPerSubmit> submitInfos{};
+    std::array<VkTimelineSemaphoreSubmitInfo, c_batchesPerSubmit> timelineInfos{};
+    std::array<VkSemaphore, c_batchesPerSubmit> waitSemaphores{};
+    std::array<uint64_t, c_batchesPerSubmit> waitValues{};
+    std::array<VkSemaphore, c_batchesPerSubmit> signalSemaphores{};
+    std::array<uint64_t, c_batchesPerSubmit> signalValues{};
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    uint32_t submitCalls = 0;
+    uint32_t batchCount = 0;
+    for (uint32_t i = 0; i < chainDepth; ++i)
+    {
+        // Batches have no command buffers, so only the semaphore operations are measured. Every batch waits
+        // for the one before it, also across chains, so that each semaphore's signals execute in order.
+        const uint32_t index = m_cursor;
+        const uint32_t previous = (index + ui32Size(m_semaphores) - 1) % ui32Size(m_semaphores);
+        waitSemaphores[batchCount] = m_semaphores[previous];
+        waitValues[batchCount] = m_values[previous];
+        m_cursor = (m_cursor + 1) % ui32Size(m_semaphores);
+        signalSemaphores[batchCount] = m_semaphores[index];
+        signalValues[batchCount] = ++m_values[index];
+
+        VkTimelineSemaphoreSubmitInfo& timelineInfo = timelineInfos[batchCount];
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &waitValues[batchCount];
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValues[batchCount];
+
+        VkSubmitInfo& submitInfo = submitInfos[batchCount];
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &waitSemaphores[batchCount];
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &signalSemaphores[batchCount];
+
+        ++batchCount;
+        if (batchCount == c_batchesPerSubmit || i + 1 == chainDepth)
+        {
+            VK_CHECK(vkQueueSubmit(m_queue, batchCount, submitInfos.data(), VK_NULL_HANDLE));
+            ++submitCalls;
+            batchCount = 0;
+        }
+    }
+    return submitCalls;
+}
+
+void SemaphoreStress::measureWakeUps(Result& result)
+{
+    const uint32_t count = ui32Size(m_semaphores);
+    std::vector<uint64_t> targetValues(count);
+
+    for (uint32_t sample = 0; sample < c_wakeUpSamples * 2; ++sample)
+    {
+        const bool waitAny = sample >= c_wakeUpSamples;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            targetValues[i] = m_values[i] + 1;
+        }
+        // Wait-any wakes up on one semaphore picked from the whole pool, wait-all on the last of them
+        const uint32_t lastIndex = waitAny ? (sample * 7919u) % count : count - 1;
+
+        uint64_t signalNanoseconds = 0;
+        std::thread signaler([this, waitAny, lastIndex, &targetValues, &signalNanoseconds] {
+            std::this_thread::sleep_for(c_signalDelay);
+
+            VkSemaphoreSignalInfo signalInfo{};
+            signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+            for (uint32_t i = 0; !waitAny && i < m_semaphores.size(); ++i)
+            {
+                if (i != lastIndex)
+                {
+                    signalInfo.semaphore = m_semaphores[i];
+                    signalInfo.value = targetValues[i];
+                    VK_CHECK(vkSignalSemaphore(m_device, &signalInfo));
+                }
+            }
+
+            signalInfo.semaphore = m_semaphores[lastIndex];
+            signalInfo.value = targetValues[lastIndex];
+            signalNanoseconds = hostNanoseconds();
+            VK_CHECK(vkSignalSemaphore(m_device, &signalInfo));
+        });
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.flags = waitAny ? VK_SEMAPHORE_WAIT_ANY_BIT : 0;
+        waitInfo.semaphoreCount = count;
+        waitInfo.pSemaphores = m_semaphores.data();
+        waitInfo.pValues = targetValues.data();
+        VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+        const uint64_t wakeNanoseconds = hostNanoseconds();
+        signaler.join();
+
+        (waitAny ? result.waitAny : result.waitAll).add(wakeNanoseconds > signalNanoseconds ? wakeNanoseconds - signalNanoseconds : 0);
+        if (waitAny)
+        {
+            m_values[lastIndex] = targetValues[lastIndex];
+        }
+        else
+        {
+            m_values = targetValues;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Timing.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Stresses timeline semaphores at counts and rates far beyond what the frame loop uses. Chains of empty
+// batches signal a pool of semaphores round-robin, each batch waiting for the previous one's signal, and the
+// host keeps a chain queued while it waits for all of the previous chain's signals with vkWaitSemaphores.
+// Host signaled waits then measure how long vkWaitSemaphores takes to wake up in wait-all and wait-any mode.
+class SemaphoreStress
+{
+public:
+    struct Result
+    {
+        uint32_t semaphoreCount = 0;
+        uint32_t chainDepth = 0;
+        double submitsPerSecond = 0.0;
+        double signalsPerSecond = 0.0;
+        LatencyHistogram waitAll;
+        LatencyHistogram waitAny;
+    };
+
+    void create(VkDevice device, VkQueue queue);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Runs one configuration for about the given time. The queue must not be used by anything else meanwhile.
+    Result run(uint32_t semaphoreCount, uint32_t chainDepth, double seconds);
+
+    static void printResults(const std::vector<Result>& results);
+
+private:
+    void createSemaphores(uint32_t count);
+    void destroySemaphores();
+    // Submits one chain and returns the number of vkQueueSubmit calls it took
+    uint32_t submitChain(uint32_t chainDepth);
+    void measureWakeUps(Result& result);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> m_semaphores;
+    // Last value signaled or submitted for signaling on each semaphore
+    std::vector<uint64_t> m_values;
+    // Next semaphore to signal, advanced round-robin
+    uint32_t m_cursor = 0;
+};
@@ -0,0 +1,319 @@
+#include "SharedTimeline.hpp"
+#include "Common.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const uint32_t c_latencyRoundTrips = 1000;
+const uint32_t c_throughputRoundTrips = 20000;
+// Round trips each process keeps queued in the throughput phase
+const uint32_t c_queuedRoundTrips = 16;
+// How long the consumer keeps trying to connect, so that it can be started before the producer
+const std::chrono::seconds c_connectTimeout(10);
+
+// Sent by the producer along with the fd. Opaque fds only import on the same device and driver.
+struct Handshake
+{
+    uint8_t deviceUUID[VK_UUID_SIZE];
+    uint8_t driverUUID[VK_UUID_SIZE];
+    uint64_t baseValue;
+};
+
+void getDeviceUUIDs(VkPhysicalDevice physicalDevice, Handshake& handshake)
+{
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    memcpy(handshake.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+    memcpy(handshake.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+}
+
+#ifndef _WIN32
+sockaddr_un socketAddress(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    CHECK(path.size() < sizeof(address.sun_path));
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+void sendFd(const std::string& path, int fd, const Handshake& handshake)
+{
+    const sockaddr_un address = socketAddress(path);
+    const int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(listenSocket >= 0);
+    unlink(path.c_str());
+    CHECK(bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    CHECK(listen(listenSocket, 1) == 0);
+
+    printf("Waiting for the consumer on %s\n", path.c_str());
+    const int connection = accept(listenSocket, nullptr, nullptr);
+    CHECK(connection >= 0);
+    close(listenSocket);
+    unlink(path.c_str());
+
+    iovec payload{};
+    payload.iov_base = const_cast<Handshake*>(&handshake);
+    payload.iov_len = sizeof(handshake);
+
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &fd, sizeof(int));
+
+    CHECK(sendmsg(connection, &message, 0) == static_cast<ssize_t>(sizeof(handshake)));
+    close(connection);
+}
+
+int receiveFd(const std::string& path, Handshake& handshake)
+{
+    const sockaddr_un address = socketAddress(path);
+    const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(connection >= 0);
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + c_connectTimeout;
+    while (connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    iovec payload{};
+    payload.iov_base = &handshake;
+    payload.iov_len = sizeof(handshake);
+
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    CHECK(recvmsg(connection, &message, MSG_WAITALL) == static_cast<ssize_t>(sizeof(handshake)));
+    close(connection);
+
+    const cmsghdr* header = CMSG_FIRSTHDR(&message);
+    CHECK(header && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS);
+    int fd = -1;
+    memcpy(&fd, CMSG_DATA(header), sizeof(int));
+    return fd;
+}
+#else
+void sendFd(const std::string& /*path*/, int /*fd*/, const Handshake& /*handshake*/)
+{
+    printf("Sharing a timeline over a Unix domain socket is not supported on Windows\n");
+    abort();
+}
+
+int receiveFd(const std::string& path, Handshake& handshake)
+{
+    sendFd(path, -1, handshake);
+    return -1;
+}
+#endif
+} // namespace
+
+bool SharedTimeline::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+
+    VkPhysicalDeviceExternalSemaphoreInfo externalInfo{};
+    externalInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO;
+    externalInfo.pNext = &timelineCreateInfo;
+    externalInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+    VkExternalSemaphoreProperties properties{};
+    properties.sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES;
+    vkGetPhysicalDeviceExternalSemaphoreProperties(physicalDevice, &externalInfo, &properties);
+
+    const VkExternalSemaphoreFeatureFlags required = VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT | VK_EXTERNAL_SEMAPHORE_FEATURE_IMPORTABLE_BIT;
+    return (properties.externalSemaphoreFeatures & required) == required;
+}
+
+VkExportSemaphoreCreateInfo SharedTimeline::exportCreateInfo(const void* next)
+{
+    VkExportSemaphoreCreateInfo exportInfo{};
+    exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
+    exportInfo.pNext = next;
+    exportInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+    return exportInfo;
+}
+
+void SharedTimeline::create(VkDevice device,
+                            VkPhysicalDevice physicalDevice,
+                            VkQueue queue,
+                            VkSemaphore semaphore,
+                            bool producer,
+                            const std::string& socketPath)
+{
+    m_queue = queue;
+    m_semaphore = semaphore;
+    m_producer = producer;
+
+    Handshake handshake{};
+    if (m_producer)
+    {
+        auto vkGetSemaphoreFdKHR = (PFN_vkGetSemaphoreFdKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreFdKHR");
+        CHECK(vkGetSemaphoreFdKHR);
+
+        VkSemaphoreGetFdInfoKHR getFdInfo{};
+        getFdInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+        getFdInfo.semaphore = m_semaphore;
+        getFdInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+        int fd = -1;
+        VK_CHECK(vkGetSemaphoreFdKHR(device, &getFdInfo, &fd));
+
+        getDeviceUUIDs(physicalDevice, handshake);
+        VK_CHECK(vkGetSemaphoreCounterValue(device, m_semaphore, &handshake.baseValue));
+        sendFd(socketPath, fd, handshake);
+        // The socket duplicated the descriptor into the consumer, the payload stays alive through the semaphore
+#ifndef _WIN32
+        close(fd);
+#endif
+    }
+    else
+    {
+        const int fd = receiveFd(socketPath, handshake);
+
+        Handshake local{};
+        getDeviceUUIDs(physicalDevice, local);
+        if (memcmp(local.deviceUUID, handshake.deviceUUID, VK_UUID_SIZE) != 0 || memcmp(local.driverUUID, handshake.driverUUID, VK_UUID_SIZE) != 0)
+        {
+            printf("The producer runs on a different device or driver, select the same one with --device\n");
+            abort();
+        }
+
+        auto vkImportSemaphoreFdKHR = (PFN_vkImportSemaphoreFdKHR)vkGetDeviceProcAddr(device, "vkImportSemaphoreFdKHR");
+        CHECK(vkImportSemaphoreFdKHR);
+
+        // On success the implementation owns the fd
+        VkImportSemaphoreFdInfoKHR importInfo{};
+        importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR;
+        importInfo.semaphore = m_semaphore;
+        importInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+        importInfo.fd = fd;
+        VK_CHECK(vkImportSemaphoreFdKHR(device, &importInfo));
+    }
+    m_baseValue = handshake.baseValue;
+    m_device = device;
+}
+
+void SharedTimeline::destroy()
+{
+    // The semaphore is owned by the caller
+    m_device = VK_NULL_HANDLE;
+}
+
+void SharedTimeline::submitHandoff(uint64_t waitValue, uint64_t signalValue)
+{
+    const uint64_t waitValues[] = {m_baseValue + waitValue};
+    const uint64_t signalValues[] = {m_baseValue + signalValue};
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &m_semaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_semaphore;
+    VK_CHECK(vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+}
+
+void SharedTimeline::waitForValue(uint64_t value)
+{
+    const uint64_t waitValue = m_baseValue + value;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &waitValue;
+    VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, c_timeout));
+}
+
+SharedTimeline::Result SharedTimeline::run()
+{
+    Result result;
+    // Round trip k is the producer signaling 2k + 1 and the consumer 2k + 2
+    const uint32_t roundTrips = c_latencyRoundTrips + c_throughputRoundTrips;
+    if (!m_producer)
+    {
+        // The consumer's submissions wait for the producer's, so it can simply stay a queue ahead throughout
+        for (uint64_t k = 0; k < roundTrips; ++k)
+        {
+            if (k >= c_queuedRoundTrips)
+            {
+                waitForValue(2 * (k - c_queuedRoundTrips) + 2);
+            }
+            submitHandoff(2 * k + 1, 2 * k + 2);
+        }
+        waitForValue(2 * static_cast<uint64_t>(roundTrips));
+        return result;
+    }
+
+    for (uint64_t k = 0; k < c_latencyRoundTrips; ++k)
+    {
+        const uint64_t start = hostNanoseconds();
+        submitHandoff(2 * k, 2 * k + 1);
+        waitForValue(2 * k + 2);
+        result.roundTrip.add(hostNanoseconds() - start);
+    }
+
+    const uint64_t start = hostNanoseconds();
+    for (uint64_t k = c_latencyRoundTrips; k < roundTrips; ++k)
+    {
+        if (k >= c_latencyRoundTrips + c_queuedRoundTrips)
+        {
+            waitForValue(2 * (k - c_queuedRoundTrips) + 2);
+        }
+        submitHandoff(2 * k, 2 * k + 1);
+    }
+    waitForValue(2 * static_cast<uint64_t>(roundTrips));
+    const double seconds = (hostNanoseconds() - start) / 1e9;
+    result.handoffsPerSecond = seconds > 0.0 ? 2.0 * c_throughputRoundTrips / seconds : 0.0;
+    return result;
+}
+
+void SharedTimeline::printResult(const Result& result)
+{
+    printf("Cross-process round trip: p50 %.2f us, p99 %.2f us, max %.2f us over %llu samples\n",
+           result.roundTrip.percentile(50.0) / 1000.0,
+           result.roundTrip.percentile(99.0) / 1000.0,
+           result.roundTrip.max() / 1000.0,
+           static_cast<unsigned long long>(result.roundTrip.count()));
+    printf("Cross-process handoffs: %.0f signals/s with %u round trips queued\n", result.handoffsPerSecond, c_queuedRoundTrips);
+}
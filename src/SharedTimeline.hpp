@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Timing.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// Shares a timeline semaphore with a second process through VK_KHR_external_semaphore_fd. The producer exports
+// it as an opaque fd and passes it over a Unix domain socket with SCM_RIGHTS, and the consumer imports it into
+// its own timeline semaphore. Both processes then submit batches that ping-pong on the one timeline: the
+// producer waits for an even value and signals the next odd one, the consumer waits for that and signals the
+// next even one. Neither process uses a fence or shares memory, the queues hand off to each other directly.
+class SharedTimeline
+{
+public:
+    struct Result
+    {
+        // Host time from the producer's submission until the consumer's signal came back
+        LatencyHistogram roundTrip;
+        // Signals per second with submissions queued ahead in both processes
+        double handoffsPerSecond = 0.0;
+    };
+
+    // Needs VK_KHR_external_semaphore_fd on the device and opaque fd export and import of timeline semaphores
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    // Chained into the semaphore's create info so that it can be exported
+    static VkExportSemaphoreCreateInfo exportCreateInfo(const void* next);
+
+    // Connects to the other process over socketPath and shares the semaphore, which must be a timeline created
+    // with exportCreateInfo(). The producer listens and sends, the consumer connects and replaces the payload of
+    // its semaphore with the imported one.
+    void create(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, VkSemaphore semaphore, bool producer, const std::string& socketPath);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Round trips in lockstep to measure latency, then with a queue of them in flight to measure the rate.
+    // Both processes must run it, only the producer's result has measurements.
+    Result run();
+
+    static void printResult(const Result& result);
+
+private:
+    // Adds an empty batch that waits for waitValue and signals signalValue, both relative to m_baseValue
+    void submitHandoff(uint64_t waitValue, uint64_t signalValue);
+    void waitForValue(uint64_t value);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    bool m_producer = false;
+    // Value of the timeline when it was shared, the ping-pong counts up from it
+    uint64_t m_baseValue = 0;
+};
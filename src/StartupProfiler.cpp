@@ -0,0 +1,78 @@
+#include "StartupProfiler.hpp"
+#include "Timing.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+StartupProfiler::Scope::Scope(StartupProfiler& profiler, const char* name) :
+    m_profiler(profiler),
+    m_name(name),
+    m_begin(hostNanoseconds())
+{
+}
+
+StartupProfiler::Scope::~Scope()
+{
+    m_profiler.record(m_name, m_begin, hostNanoseconds());
+}
+
+StartupProfiler::StartupProfiler() :
+    m_start(hostNanoseconds()),
+    m_mainThread(std::this_thread::get_id())
+{
+}
+
+void StartupProfiler::record(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back({name, beginNanoseconds, endNanoseconds, std::this_thread::get_id()});
+}
+
+void StartupProfiler::finish(const char* milestone)
+{
+    const uint64_t now = hostNanoseconds();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_milestone == nullptr)
+    {
+        m_milestone = milestone;
+        m_end = now;
+    }
+}
+
+void StartupProfiler::print()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_milestone == nullptr || m_printed)
+    {
+        return;
+    }
+    m_printed = true;
+
+    std::stable_sort(m_phases.begin(), m_phases.end(), [](const Phase& a, const Phase& b) { return a.begin < b.begin; });
+
+    // Every thread other than main gets a number in order of its first phase
+    std::vector<std::thread::id> workers;
+    printf("\nStartup, ms since process start:\n");
+    printf("%-24s %10s %10s %10s  %s\n", "phase", "begin", "end", "duration", "thread");
+    for (const Phase& phase : m_phases)
+    {
+        char thread[16] = "main";
+        if (phase.thread != m_mainThread)
+        {
+            std::vector<std::thread::id>::iterator it = std::find(workers.begin(), workers.end(), phase.thread);
+            if (it == workers.end())
+            {
+                it = workers.insert(workers.end(), phase.thread);
+            }
+            snprintf(thread, sizeof(thread), "worker %d", static_cast<int>(it - workers.begin()) + 1);
+        }
+        printf("%-24s %10.2f %10.2f %10.2f  %s\n",
+               phase.name,
+               (phase.begin - m_start) / 1e6,
+               (phase.end - m_start) / 1e6,
+               (phase.end - phase.begin) / 1e6,
+               thread);
+    }
+    printf("%-24s %10.2f\n\n", m_milestone, (m_end - m_start) / 1e6);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Times the startup phases, which may run on several threads, relative to the profiler's construction. As a
+// global it is constructed before main(), so the milestone given to finish() is reported from process start.
+class StartupProfiler
+{
+public:
+    class Scope
+    {
+    public:
+        Scope(StartupProfiler& profiler, const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupProfiler& m_profiler;
+        const char* m_name;
+        uint64_t m_begin;
+    };
+
+    StartupProfiler();
+
+    // Thread safe
+    void record(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+    // Marks the end of startup, only the first call counts
+    void finish(const char* milestone);
+    // Prints every phase once startup has finished, separate from finish() to keep printing out of the first frame
+    void print();
+
+private:
+    struct Phase
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+        std::thread::id thread;
+    };
+
+    const uint64_t m_start;
+    const std::thread::id m_mainThread;
+    std::mutex m_mutex;
+    std::vector<Phase> m_phases;
+    const char* m_milestone = nullptr;
+    uint64_t m_end = 0;
+    bool m_printed = false;
+};
@@ -0,0 +1,167 @@
+#include "SubmitBatcher.hpp"
+#include "Common.hpp"
+
+namespace
+{
+// Stages that only exist in synchronization2 fall back to the legacy stage that contains them
+VkPipelineStageFlags toLegacyStages(VkPipelineStageFlags2KHR stages)
+{
+    const VkPipelineStageFlags2KHR transferStages = VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR;
+    VkPipelineStageFlags legacy = static_cast<VkPipelineStageFlags>(stages & 0xffffffffull);
+    if (stages & transferStages)
+    {
+        legacy |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    if (stages & ~(0xffffffffull | transferStages))
+    {
+        legacy |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+    return legacy != 0 ? legacy : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+} // namespace
+
+void SubmitBatcher::create(VkDevice device, VkQueue queue, bool synchronization2, bool timelineSemaphores)
+{
+    m_queue = queue;
+    m_timelineSemaphores = timelineSemaphores;
+    m_vkQueueSubmit2 = synchronization2 ? (PFN_vkQueueSubmit2KHR)vkGetDeviceProcAddr(device, "vkQueueSubmit2KHR") : nullptr;
+}
+
+void SubmitBatcher::beginBatch()
+{
+    CHECK(m_batchCount < c_maxBatches);
+    Batch& batch = m_batches[m_batchCount++];
+    batch.firstWait = m_waitCount;
+    batch.waitCount = 0;
+    batch.firstCommandBuffer = m_commandBufferCount;
+    batch.commandBufferCount = 0;
+    batch.firstSignal = m_signalCount;
+    batch.signalCount = 0;
+}
+
+void SubmitBatcher::addWait(VkSemaphore semaphore, VkPipelineStageFlags2KHR stages, uint64_t value)
+{
+    CHECK(m_batchCount > 0 && m_waitCount < c_maxSemaphores);
+    VkSemaphoreSubmitInfoKHR& info = m_waits[m_waitCount++];
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR;
+    info.semaphore = semaphore;
+    info.value = value;
+    info.stageMask = stages;
+    ++m_batches[m_batchCount - 1].waitCount;
+}
+
+void SubmitBatcher::addCommandBuffer(VkCommandBuffer cb)
+{
+    CHECK(m_batchCount > 0 && m_commandBufferCount < c_maxCommandBuffers);
+    VkCommandBufferSubmitInfoKHR& info = m_commandBuffers[m_commandBufferCount++];
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR;
+    info.commandBuffer = cb;
+    ++m_batches[m_batchCount - 1].commandBufferCount;
+}
+
+void SubmitBatcher::addSignal(VkSemaphore semaphore, VkPipelineStageFlags2KHR stages, uint64_t value)
+{
+    CHECK(m_batchCount > 0 && m_signalCount < c_maxSemaphores);
+    VkSemaphoreSubmitInfoKHR& info = m_signals[m_signalCount++];
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR;
+    info.semaphore = semaphore;
+    info.value = value;
+    info.stageMask = stages;
+    ++m_batches[m_batchCount - 1].signalCount;
+}
+
+void SubmitBatcher::flush(VkFence fence)
+{
+    if (m_batchCount == 0 && fence == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (usesSynchronization2())
+    {
+        submit2(fence);
+    }
+    else
+    {
+        submit(fence);
+    }
+
+    m_batchCount = 0;
+    m_waitCount = 0;
+    m_commandBufferCount = 0;
+    m_signalCount = 0;
+}
+
+void SubmitBatcher::submit2(VkFence fence)
+{
+    std::array<VkSubmitInfo2KHR, c_maxBatches> submitInfos{};
+    for (uint32_t i = 0; i < m_batchCount; ++i)
+    {
+        const Batch& batch = m_batches[i];
+        VkSubmitInfo2KHR& submitInfo = submitInfos[i];
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR;
+        submitInfo.waitSemaphoreInfoCount = batch.waitCount;
+        submitInfo.pWaitSemaphoreInfos = &m_waits[batch.firstWait];
+        submitInfo.commandBufferInfoCount = batch.commandBufferCount;
+        submitInfo.pCommandBufferInfos = &m_commandBuffers[batch.firstCommandBuffer];
+        submitInfo.signalSemaphoreInfoCount = batch.signalCount;
+        submitInfo.pSignalSemaphoreInfos = &m_signals[batch.firstSignal];
+    }
+
+    VK_CHECK(m_vkQueueSubmit2(m_queue, m_batchCount, submitInfos.data(), fence));
+}
+
+void SubmitBatcher::submit(VkFence fence)
+{
+    std::array<VkSemaphore, c_maxSemaphores> waitSemaphores{};
+    std::array<VkPipelineStageFlags, c_maxSemaphores> waitStages{};
+    std::array<uint64_t, c_maxSemaphores> waitValues{};
+    for (uint32_t i = 0; i < m_waitCount; ++i)
+    {
+        waitSemaphores[i] = m_waits[i].semaphore;
+        waitStages[i] = toLegacyStages(m_waits[i].stageMask);
+        waitValues[i] = m_waits[i].value;
+    }
+
+    std::array<VkCommandBuffer, c_maxCommandBuffers> commandBuffers{};
+    for (uint32_t i = 0; i < m_commandBufferCount; ++i)
+    {
+        commandBuffers[i] = m_commandBuffers[i].commandBuffer;
+    }
+
+    // Legacy signals always cover all commands, so their stage masks are dropped
+    std::array<VkSemaphore, c_maxSemaphores> signalSemaphores{};
+    std::array<uint64_t, c_maxSemaphores> signalValues{};
+    for (uint32_t i = 0; i < m_signalCount; ++i)
+    {
+        signalSemaphores[i] = m_signals[i].semaphore;
+        signalValues[i] = m_signals[i].value;
+    }
+
+    std::array<VkTimelineSemaphoreSubmitInfo, c_maxBatches> timelineInfos{};
+    std::array<VkSubmitInfo, c_maxBatches> submitInfos{};
+    for (uint32_t i = 0; i < m_batchCount; ++i)
+    {
+        const Batch& batch = m_batches[i];
+
+        VkTimelineSemaphoreSubmitInfo& timelineInfo = timelineInfos[i];
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = batch.waitCount;
+        timelineInfo.pWaitSemaphoreValues = &waitValues[batch.firstWait];
+        timelineInfo.signalSemaphoreValueCount = batch.signalCount;
+        timelineInfo.pSignalSemaphoreValues = &signalValues[batch.firstSignal];
+
+        VkSubmitInfo& submitInfo = submitInfos[i];
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = m_timelineSemaphores ? &timelineInfo : nullptr;
+        submitInfo.waitSemaphoreCount = batch.waitCount;
+        submitInfo.pWaitSemaphores = &waitSemaphores[batch.firstWait];
+        submitInfo.pWaitDstStageMask = &waitStages[batch.firstWait];
+        submitInfo.commandBufferCount = batch.commandBufferCount;
+        submitInfo.pCommandBuffers = &commandBuffers[batch.firstCommandBuffer];
+        submitInfo.signalSemaphoreCount = batch.signalCount;
+        submitInfo.pSignalSemaphores = &signalSemaphores[batch.firstSignal];
+    }
+
+    VK_CHECK(vkQueueSubmit(m_queue, m_batchCount, submitInfos.data(), fence));
+}
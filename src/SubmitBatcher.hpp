@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+
+// Collects queue submissions in fixed-capacity storage and makes them with a single vkQueueSubmit2 call per
+// flush, or a single vkQueueSubmit when VK_KHR_synchronization2 is not available. Waits and signals take
+// synchronization2 stage masks, values are ignored for binary semaphores. Nothing is allocated per submit.
+class SubmitBatcher
+{
+public:
+    static const uint32_t c_maxBatches = 4;
+    static const uint32_t c_maxSemaphores = 8;
+    static const uint32_t c_maxCommandBuffers = 4;
+
+    // timelineSemaphores chains the values on the vkQueueSubmit path, so it must be false on devices without them
+    void create(VkDevice device, VkQueue queue, bool synchronization2, bool timelineSemaphores);
+
+    bool usesSynchronization2() const { return m_vkQueueSubmit2 != nullptr; }
+
+    // Starts a new batch, i.e. VkSubmitInfo2, that the following calls add to
+    void beginBatch();
+    void addWait(VkSemaphore semaphore, VkPipelineStageFlags2KHR stages, uint64_t value = 0);
+    void addCommandBuffer(VkCommandBuffer cb);
+    void addSignal(VkSemaphore semaphore, VkPipelineStageFlags2KHR stages, uint64_t value = 0);
+    // Submits every batch since the last flush in one call. The fence is signaled once all of them complete.
+    void flush(VkFence fence = VK_NULL_HANDLE);
+
+private:
+    struct Batch
+    {
+        uint32_t firstWait;
+        uint32_t waitCount;
+        uint32_t firstCommandBuffer;
+        uint32_t commandBufferCount;
+        uint32_t firstSignal;
+        uint32_t signalCount;
+    };
+
+    void submit2(VkFence fence);
+    void submit(VkFence fence);
+
+    VkQueue m_queue = VK_NULL_HANDLE;
+    PFN_vkQueueSubmit2KHR m_vkQueueSubmit2 = nullptr;
+    bool m_timelineSemaphores = false;
+
+    std::array<Batch, c_maxBatches> m_batches{};
+    uint32_t m_batchCount = 0;
+    std::array<VkSemaphoreSubmitInfoKHR, c_maxSemaphores> m_waits{};
+    uint32_t m_waitCount = 0;
+    std::array<VkCommandBufferSubmitInfoKHR, c_maxCommandBuffers> m_commandBuffers{};
+    uint32_t m_commandBufferCount = 0;
+    std::array<VkSemaphoreSubmitInfoKHR, c_maxSemaphores> m_signals{};
+    uint32_t m_signalCount = 0;
+};
@@ -0,0 +1,194 @@
+#include "SubmitThread.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+
+void SubmitThread::create(VkDevice device,
+                          VkQueue graphicsQueue,
+                          VkQueue presentQueue,
+                          VkSemaphore timelineSemaphore,
+                          bool synchronization2,
+                          PresentWaiter& presentWaiter,
+                          TraceRecorder& trace)
+{
+    m_presentQueue = presentQueue;
+    m_timelineSemaphore = timelineSemaphore;
+    m_submits.create(device, graphicsQueue, synchronization2, true);
+    m_presentWaiter = &presentWaiter;
+    m_trace = &trace;
+    m_device = device;
+    m_stopping = false;
+    m_completed = 0;
+    m_pushed = 0;
+    resetCounters();
+    m_worker = std::thread(&SubmitThread::workerLoop, this);
+}
+
+void SubmitThread::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_packetAdded.notify_one();
+    m_worker.join();
+    m_device = VK_NULL_HANDLE;
+}
+
+void SubmitThread::enqueue(const Packet& packet)
+{
+    const uint32_t depth = static_cast<uint32_t>(m_pushed - m_completed.load(std::memory_order_acquire));
+    m_depthSum += depth;
+    m_maxDepth = std::max(m_maxDepth, depth);
+    ++m_enqueued;
+
+    if (!m_ring.tryPush(packet))
+    {
+        ++m_stalls;
+        while (!m_ring.tryPush(packet))
+        {
+            std::this_thread::yield();
+        }
+    }
+    ++m_pushed;
+
+    // Pairs with the fence in workerLoop(): either the worker sees the packet before it parks or this sees it
+    // parking and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_packetAdded.notify_one();
+    }
+}
+
+void SubmitThread::waitForPending(uint64_t maxPending)
+{
+    if (m_pushed - m_completed.load(std::memory_order_acquire) <= maxPending)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_waiting.store(true, std::memory_order_relaxed);
+    // Pairs with the fence in workerLoop() after a packet is completed
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_packetCompleted.wait(lock, [this, maxPending]() { return m_pushed - m_completed.load(std::memory_order_acquire) <= maxPending; });
+    m_waiting.store(false, std::memory_order_relaxed);
+}
+
+void SubmitThread::collect(LatencyHistogram& submitTimes, LatencyHistogram& presentTimes)
+{
+    CHECK(m_completed.load(std::memory_order_acquire) == m_pushed);
+    submitTimes = m_submitTimes;
+    presentTimes = m_presentTimes;
+}
+
+void SubmitThread::resetCounters()
+{
+    CHECK(m_completed.load(std::memory_order_acquire) == m_pushed);
+    m_submitTimes.reset();
+    m_presentTimes.reset();
+    m_enqueued = 0;
+    m_depthSum = 0;
+    m_maxDepth = 0;
+    m_stalls = 0;
+}
+
+void SubmitThread::workerLoop()
+{
+    m_trace->nameThread("submit");
+    Packet packet;
+    for (;;)
+    {
+        if (m_ring.tryPop(packet))
+        {
+            process(packet);
+            m_completed.fetch_add(1, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiting.load(std::memory_order_relaxed))
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_packetCompleted.notify_one();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping)
+        {
+            return;
+        }
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_ring.size() == 0)
+        {
+            m_packetAdded.wait(lock);
+        }
+        m_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void SubmitThread::process(const Packet& packet)
+{
+    const uint64_t submitBegin = hostNanoseconds();
+    m_submits.beginBatch();
+    if (packet.imageAvailableSemaphore != VK_NULL_HANDLE)
+    {
+        m_submits.addWait(packet.imageAvailableSemaphore, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+        m_submits.addSignal(packet.renderFinishedSemaphore, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+    }
+    m_submits.addCommandBuffer(packet.commandBuffer);
+    m_submits.addSignal(m_timelineSemaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, packet.signalValue);
+    m_submits.flush();
+    const uint64_t submitEnd = hostNanoseconds();
+    m_submitTimes.add(submitEnd - submitBegin);
+    m_trace->span(framePhaseName(FramePhase::QueueSubmit), submitBegin, submitEnd);
+
+    if (packet.swapchain == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &packet.presentId;
+
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.pNext = packet.presentId != 0 ? &presentId : nullptr;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &packet.renderFinishedSemaphore;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &packet.swapchain;
+    presentInfo.pImageIndices = &packet.imageIndex;
+
+    if (packet.presentId != 0)
+    {
+        m_presentWaiter->add(packet.swapchain, packet.presentId, packet.submitNanoseconds);
+    }
+
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(m_swapchainMutex);
+        result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    }
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        m_swapchainDirty = true;
+    }
+    else
+    {
+        VK_CHECK(result);
+    }
+    const uint64_t presentEnd = hostNanoseconds();
+    m_presentTimes.add(presentEnd - submitEnd);
+    m_trace->span(framePhaseName(FramePhase::QueuePresent), submitEnd, presentEnd);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "PresentWaiter.hpp"
+#include "SpscRing.hpp"
+#include "SubmitBatcher.hpp"
+#include "Timing.hpp"
+#include "Trace.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Makes the frame's queue submission and present on its own thread, so that a vkQueuePresentKHR that blocks
+// on the presentation engine no longer holds up input handling and recording on the main thread. The main
+// thread records and hands each frame over as a packet through a lock-free single producer, single consumer
+// ring. Frame slot reuse still works on timeline values, a host wait for a value whose submission is still
+// in the ring simply waits until the thread has made it.
+class SubmitThread
+{
+public:
+    struct Packet
+    {
+        VkCommandBuffer commandBuffer;
+        // Binary semaphores of the acquired image, null when headless
+        VkSemaphore imageAvailableSemaphore;
+        VkSemaphore renderFinishedSemaphore;
+        // Value of the timeline semaphore the submission signals
+        uint64_t signalValue;
+        // Presented if not null, with presentId when it is not 0
+        VkSwapchainKHR swapchain;
+        uint32_t imageIndex;
+        uint64_t presentId;
+        uint64_t submitNanoseconds;
+    };
+
+    void create(VkDevice device,
+                VkQueue graphicsQueue,
+                VkQueue presentQueue,
+                VkSemaphore timelineSemaphore,
+                bool synchronization2,
+                PresentWaiter& presentWaiter,
+                TraceRecorder& trace);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Main thread only. Blocks while the ring is full.
+    void enqueue(const Packet& packet);
+    // Main thread only. Blocks until every enqueued packet has been submitted and presented, e.g. before the
+    // swapchain is replaced or the queues are waited for.
+    void waitIdle() { waitForPending(0); }
+    // Main thread only. Blocks until at most maxPending packets are left to be submitted and presented.
+    void waitForPending(uint64_t maxPending);
+    // Whether a present reported the swapchain as out of date or suboptimal since the last call
+    bool takeSwapchainDirty() { return m_swapchainDirty.exchange(false); }
+    // vkAcquireNextImageKHR must hold this, presents to the same swapchain are made under it
+    std::mutex& swapchainMutex() { return m_swapchainMutex; }
+
+    // Main thread only. Must be idle.
+    void collect(LatencyHistogram& submitTimes, LatencyHistogram& presentTimes);
+    void resetCounters();
+    // Packets already in the ring when one was enqueued, i.e. how far the main thread ran ahead
+    double meanDepth() const { return m_enqueued ? static_cast<double>(m_depthSum) / m_enqueued : 0.0; }
+    uint32_t maxDepth() const { return m_maxDepth; }
+    uint64_t stalls() const { return m_stalls; }
+
+private:
+    static const uint32_t c_capacity = 16;
+
+    void workerLoop();
+    void process(const Packet& packet);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_presentQueue = VK_NULL_HANDLE;
+    VkSemaphore m_timelineSemaphore = VK_NULL_HANDLE;
+    SubmitBatcher m_submits;
+    PresentWaiter* m_presentWaiter = nullptr;
+    TraceRecorder* m_trace = nullptr;
+    std::thread m_worker;
+
+    SpscRing<Packet, c_capacity> m_ring;
+    // The worker parks on the condition variable when the ring is empty and m_sleeping tells the main thread
+    // to wake it, so an enqueue takes no lock while the worker is busy
+    std::mutex m_mutex;
+    std::condition_variable m_packetAdded;
+    std::atomic<bool> m_sleeping{false};
+    bool m_stopping = false;
+    std::atomic<uint64_t> m_completed{0};
+    // The same for the main thread parked in waitForPending() and the worker that completes a packet
+    std::condition_variable m_packetCompleted;
+    std::atomic<bool> m_waiting{false};
+    std::atomic<bool> m_swapchainDirty{false};
+    std::mutex m_swapchainMutex;
+
+    // Written by the worker only, read once it is idle
+    LatencyHistogram m_submitTimes;
+    LatencyHistogram m_presentTimes;
+
+    // Main thread only. m_pushed counts every packet, the others are since the last resetCounters().
+    uint64_t m_pushed = 0;
+    uint64_t m_enqueued = 0;
+    uint64_t m_depthSum = 0;
+    uint32_t m_maxDepth = 0;
+    uint64_t m_stalls = 0;
+};
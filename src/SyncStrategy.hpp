@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstring>
+
+// How the CPU paces itself against the GPU and how consecutive frames are ordered
+enum class SyncStrategy
+{
+    // A fence per frame slot, binary semaphores only for acquire and present
+    Fence,
+    // A fence per frame slot, plus each frame's submit waiting on a binary semaphore signaled by the
+    // previous frame's submit
+    Binary,
+    // One device-wide timeline semaphore that every submit signals and the CPU waits on
+    Timeline,
+    Count
+};
+
+inline const char* syncStrategyName(SyncStrategy strategy)
+{
+    switch (strategy)
+    {
+    case SyncStrategy::Fence:
+        return "fence";
+    case SyncStrategy::Binary:
+        return "binary";
+    case SyncStrategy::Timeline:
+        return "timeline";
+    default:
+        return "unknown";
+    }
+}
+
+inline bool parseSyncStrategy(const char* name, SyncStrategy& strategy)
+{
+    for (int i = 0; i < static_cast<int>(SyncStrategy::Count); ++i)
+    {
+        if (strcmp(name, syncStrategyName(static_cast<SyncStrategy>(i))) == 0)
+        {
+            strategy = static_cast<SyncStrategy>(i);
+            return true;
+        }
+    }
+    return false;
+}
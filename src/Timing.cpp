@@ -0,0 +1,348 @@
+#include "Timing.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+const char* c_phaseNames[] = {"wait", "pace", "acquire", "upload", "record", "submit", "present", "frame", "gpu", "compute", "overlap", "produce", "handoff", "display", "latency", "qsubmit", "qpresent"};
+static_assert(sizeof(c_phaseNames) / sizeof(c_phaseNames[0]) == static_cast<size_t>(FramePhase::Count), "Phase name missing");
+
+uint32_t mostSignificantBit(uint64_t value)
+{
+    uint32_t msb = 0;
+    while (value >>= 1)
+    {
+        ++msb;
+    }
+    return msb;
+}
+
+double toMicroseconds(uint64_t nanoseconds)
+{
+    return nanoseconds / 1000.0;
+}
+
+// JSON has no infinity or NaN, the regression tests treat null as a failed result
+std::string jsonNumber(double value)
+{
+    if (!std::isfinite(value))
+    {
+        return "null";
+    }
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+bool endsWith(const std::string& str, const char* suffix)
+{
+    const std::string suffixStr(suffix);
+    return str.size() >= suffixStr.size() && str.compare(str.size() - suffixStr.size(), suffixStr.size(), suffixStr) == 0;
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram() :
+    m_buckets(c_bucketCount, 0)
+{
+}
+
+uint32_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < c_subBucketCount)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    const uint32_t msb = mostSignificantBit(value);
+    const uint32_t shift = msb - c_subBucketBits;
+    const uint32_t subBucket = static_cast<uint32_t>(value >> shift) - c_subBucketCount;
+    return c_subBucketCount + shift * c_subBucketCount + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index)
+{
+    if (index < c_subBucketCount)
+    {
+        return index;
+    }
+
+    const uint32_t shift = (index - c_subBucketCount) / c_subBucketCount;
+    const uint64_t subBucket = (index - c_subBucketCount) % c_subBucketCount;
+    return ((c_subBucketCount + subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t nanoseconds)
+{
+    ++m_buckets[bucketIndex(nanoseconds)];
+    ++m_count;
+    m_sum += nanoseconds;
+    m_min = nanoseconds < m_min ? nanoseconds : m_min;
+    m_max = nanoseconds > m_max ? nanoseconds : m_max;
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * m_count));
+    target = target == 0 ? 1 : target;
+
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < c_bucketCount; ++i)
+    {
+        cumulative += m_buckets[i];
+        if (cumulative >= target)
+        {
+            const uint64_t upperBound = bucketUpperBound(i);
+            return upperBound < m_max ? upperBound : m_max;
+        }
+    }
+    return m_max;
+}
+
+const char* framePhaseName(FramePhase phase)
+{
+    return c_phaseNames[static_cast<size_t>(phase)];
+}
+
+void FrameStats::print() const
+{
+    printf("%-8s %10s %10s %10s %10s %10s %10s\n", "phase", "count", "mean us", "p50 us", "p95 us", "p99 us", "max us");
+    for (size_t i = 0; i < m_histograms.size(); ++i)
+    {
+        const LatencyHistogram& h = m_histograms[i];
+        if (h.count() == 0)
+        {
+            continue;
+        }
+        printf("%-8s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               c_phaseNames[i],
+               static_cast<unsigned long long>(h.count()),
+               h.mean() / 1000.0,
+               toMicroseconds(h.percentile(50.0)),
+               toMicroseconds(h.percentile(95.0)),
+               toMicroseconds(h.percentile(99.0)),
+               toMicroseconds(h.max()));
+    }
+}
+
+bool FrameStats::exportToFile(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        printf("Failed to open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    const bool json = endsWith(path, ".json");
+    if (json)
+    {
+        fprintf(file, "{\n  \"phases\": {");
+    }
+    else
+    {
+        fprintf(file, "phase,count,mean_us,p50_us,p95_us,p99_us,max_us\n");
+    }
+
+    bool first = true;
+    for (size_t i = 0; i < m_histograms.size(); ++i)
+    {
+        const LatencyHistogram& h = m_histograms[i];
+        if (h.count() == 0)
+        {
+            continue;
+        }
+
+        const char* format = json
+            ? "%s\n    \"%s\": {\"count\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p95_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}"
+            : "%s%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n";
+        fprintf(file,
+                format,
+                json && !first ? "," : "",
+                c_phaseNames[i],
+                static_cast<unsigned long long>(h.count()),
+                h.mean() / 1000.0,
+                toMicroseconds(h.percentile(50.0)),
+                toMicroseconds(h.percentile(95.0)),
+                toMicroseconds(h.percentile(99.0)),
+                toMicroseconds(h.max()));
+        first = false;
+    }
+
+    if (json)
+    {
+        fprintf(file, "\n  }\n}\n");
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool exportBenchmarkResults(const std::string& path, const std::vector<BenchmarkResult>& results)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        printf("Failed to open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n  \"results\": [");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        fprintf(file,
+                "%s\n    {\"name\": \"%s\", \"throughput\": %s, \"p99_us\": %s}",
+                i > 0 ? "," : "",
+                results[i].name.c_str(),
+                jsonNumber(results[i].throughput).c_str(),
+                jsonNumber(results[i].p99Microseconds).c_str());
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+void GpuTimestamps::create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t slotCount)
+{
+    m_device = device;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+    if (validBits == 0)
+    {
+        printf("GPU timestamps not supported on queue family %u\n", queueFamily);
+        return;
+    }
+    m_timestampMask = validBits >= 64 ? UINT64_MAX : ((1ull << validBits) - 1);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_timestampPeriod = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = slotCount * 2;
+
+    VK_CHECK(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_queryPool));
+    m_pending.assign(slotCount, 0);
+}
+
+void GpuTimestamps::destroy()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+}
+
+void GpuTimestamps::cmdBegin(VkCommandBuffer cb, uint32_t slot)
+{
+    if (!isSupported())
+    {
+        return;
+    }
+    vkCmdResetQueryPool(cb, m_queryPool, slot * 2, 2);
+    vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, slot * 2);
+}
+
+void GpuTimestamps::cmdEnd(VkCommandBuffer cb, uint32_t slot)
+{
+    if (!isSupported())
+    {
+        return;
+    }
+    vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, slot * 2 + 1);
+    m_pending[slot] = 1;
+}
+
+bool GpuTimestamps::collect(uint32_t slot, GpuInterval& interval)
+{
+    if (!isSupported() || !m_pending[slot])
+    {
+        return false;
+    }
+
+    std::array<uint64_t, 2> timestamps{};
+    const VkResult result = vkGetQueryPoolResults(m_device,
+                                                  m_queryPool,
+                                                  slot * 2,
+                                                  2,
+                                                  sizeof(timestamps),
+                                                  timestamps.data(),
+                                                  sizeof(uint64_t),
+                                                  VK_QUERY_RESULT_64_BIT);
+    if (result == VK_NOT_READY)
+    {
+        return false;
+    }
+    VK_CHECK(result);
+    m_pending[slot] = 0;
+
+    // The end is derived from the masked difference so that a counter wrap between the two writes is harmless
+    const uint64_t ticks = (timestamps[1] - timestamps[0]) & m_timestampMask;
+    interval.begin = static_cast<uint64_t>((timestamps[0] & m_timestampMask) * m_timestampPeriod);
+    interval.end = interval.begin + static_cast<uint64_t>(ticks * m_timestampPeriod);
+    return true;
+}
+
+bool GpuTimestamps::calibrate(VkInstance instance, VkPhysicalDevice physicalDevice)
+{
+    auto vkGetPhysicalDeviceCalibrateableTimeDomainsEXT =
+        (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+    auto vkGetCalibratedTimestampsEXT = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(m_device, "vkGetCalibratedTimestampsEXT");
+    if (!isSupported() || !vkGetPhysicalDeviceCalibrateableTimeDomainsEXT || !vkGetCalibratedTimestampsEXT)
+    {
+        return false;
+    }
+
+    uint32_t timeDomainCount = 0;
+    VK_CHECK(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &timeDomainCount, nullptr));
+    std::vector<VkTimeDomainEXT> timeDomains(timeDomainCount);
+    VK_CHECK(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &timeDomainCount, timeDomains.data()));
+
+    const bool hasDevice = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != timeDomains.end();
+    const bool hasMonotonic = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) != timeDomains.end();
+    if (!hasDevice || !hasMonotonic)
+    {
+        return false;
+    }
+
+    std::array<VkCalibratedTimestampInfoEXT, 2> infos{};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+    std::array<uint64_t, 2> timestamps{};
+    uint64_t maxDeviation = 0;
+    VK_CHECK(vkGetCalibratedTimestampsEXT(m_device, ui32Size(infos), infos.data(), timestamps.data(), &maxDeviation));
+
+    // Unsigned wrap-around makes the offset work in either direction
+    const uint64_t deviceNanoseconds = static_cast<uint64_t>((timestamps[0] & m_timestampMask) * m_timestampPeriod);
+    m_hostOffset = timestamps[1] - deviceNanoseconds;
+    m_calibrated = true;
+    return true;
+}
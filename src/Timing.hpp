@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fixed-size log-linear histogram of durations in nanoseconds. Values are exact below 32 ns and are
+// otherwise bucketed with 32 sub-buckets per power of two, i.e. about 3% resolution, so percentiles stay
+// accurate at the tail without storing every sample.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const { return m_count; }
+    uint64_t min() const { return m_count ? m_min : 0; }
+    uint64_t max() const { return m_max; }
+    double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+    // Upper bound of the bucket holding the given percentile (0-100), clamped to the exact maximum
+    uint64_t percentile(double p) const;
+
+private:
+    static const uint32_t c_subBucketBits = 5;
+    static const uint32_t c_subBucketCount = 1u << c_subBucketBits;
+    static const uint32_t c_bucketCount = (64 - c_subBucketBits + 1) * c_subBucketCount;
+
+    static uint32_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(uint32_t index);
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_min = UINT64_MAX;
+    uint64_t m_max = 0;
+};
+
+// Host time in nanoseconds on the steady clock, which is CLOCK_MONOTONIC on Linux
+inline uint64_t hostNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class ScopedTimer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit ScopedTimer(LatencyHistogram& histogram) :
+        m_histogram(histogram),
+        m_start(Clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        m_histogram.add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    LatencyHistogram& m_histogram;
+    Clock::time_point m_start;
+};
+
+enum class FramePhase
+{
+    Wait,
+    // Time the frame pacer delayed the frame start by
+    Pace,
+    Acquire,
+    // CPU time spent writing the frame's uploads into the staging ring, including stalls on a full ring
+    Upload,
+    Record,
+    Submit,
+    Present,
+    Frame,
+    Gpu,
+    // GPU time of the async compute submission and how much of it overlapped the graphics submission
+    ComputeGpu,
+    Overlap,
+    // CPU time a host producer thread spent on the frame's data and the latency from its vkSignalSemaphore
+    // until the GPU had copied the data
+    Produce,
+    Handoff,
+    // From the frame's queue submission until VK_KHR_present_wait reported it as presented
+    Display,
+    // From the frame start, when input would be sampled, until the GPU finished the frame. Needs calibrated
+    // timestamps.
+    Latency,
+    // Time the submit thread spent in the queue submission and the present it took off the main thread
+    QueueSubmit,
+    QueuePresent,
+    Count
+};
+
+const char* framePhaseName(FramePhase phase);
+
+class FrameStats
+{
+public:
+    LatencyHistogram& phase(FramePhase phase) { return m_histograms[static_cast<size_t>(phase)]; }
+    const LatencyHistogram& phase(FramePhase phase) const { return m_histograms[static_cast<size_t>(phase)]; }
+
+    void print() const;
+    // Format is chosen by extension: .json writes JSON, anything else CSV
+    bool exportToFile(const std::string& path) const;
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(FramePhase::Count)> m_histograms;
+};
+
+// One measurement of a benchmark scenario, compared against the checked-in baseline by CTest
+struct BenchmarkResult
+{
+    std::string name;
+    // Higher is better, e.g. frames or submits per second
+    double throughput;
+    double p99Microseconds;
+};
+
+// Writes the results as JSON for the benchmark regression tests
+bool exportBenchmarkResults(const std::string& path, const std::vector<BenchmarkResult>& results);
+
+// Begin and end of a GPU interval in nanoseconds on the device timestamp clock
+struct GpuInterval
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+// Pair of timestamp queries per frame slot written around a frame's GPU work on one queue family
+class GpuTimestamps
+{
+public:
+    void create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t slotCount);
+    void destroy();
+
+    bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+    void cmdBegin(VkCommandBuffer cb, uint32_t slot);
+    void cmdEnd(VkCommandBuffer cb, uint32_t slot);
+    // For a command buffer recorded with cmdBegin() and cmdEnd() earlier that is submitted again
+    void markPending(uint32_t slot)
+    {
+        if (isSupported())
+        {
+            m_pending[slot] = 1;
+        }
+    }
+    // Must only be called once the slot's last submission has completed. Returns false if the slot has
+    // no results pending.
+    bool collect(uint32_t slot, GpuInterval& interval);
+
+    // Measures the offset between the device timestamp clock and hostNanoseconds() with
+    // VK_EXT_calibrated_timestamps, which must be enabled on the device. Returns false if the device cannot
+    // calibrate against CLOCK_MONOTONIC.
+    bool calibrate(VkInstance instance, VkPhysicalDevice physicalDevice);
+    bool isCalibrated() const { return m_calibrated; }
+    uint64_t toHostNanoseconds(uint64_t gpuNanoseconds) const { return gpuNanoseconds + m_hostOffset; }
+    int64_t hostOffset() const { return static_cast<int64_t>(m_hostOffset); }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    double m_timestampPeriod = 1.0;
+    uint64_t m_timestampMask = 0;
+    std::vector<char> m_pending;
+    bool m_calibrated = false;
+    uint64_t m_hostOffset = 0;
+};
@@ -0,0 +1,210 @@
+#include "Trace.hpp"
+#include "Timing.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+const int c_cpuProcessId = 1;
+const int c_gpuProcessId = 2;
+
+// Every create() starts a new session so that a thread's cached buffer from an earlier one is not reused
+std::atomic<uint64_t> s_lastSession{0};
+thread_local uint64_t t_session = 0;
+thread_local void* t_buffer = nullptr;
+
+double toMicroseconds(int64_t nanoseconds)
+{
+    return nanoseconds / 1000.0;
+}
+} // namespace
+
+void TraceRecorder::create(uint32_t eventsPerThread)
+{
+    m_eventsPerThread = eventsPerThread;
+    m_session = ++s_lastSession;
+    m_origin = hostNanoseconds();
+    m_gpuClockOffset = INT64_MIN;
+    m_gpuClockCalibrated = false;
+    nameThread("main");
+}
+
+void TraceRecorder::destroy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.clear();
+    m_eventsPerThread = 0;
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::threadBuffer()
+{
+    if (t_session == m_session)
+    {
+        return static_cast<ThreadBuffer*>(t_buffer);
+    }
+
+    // First event of this thread in the session, the only time recording takes the lock
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->events.resize(m_eventsPerThread);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->threadId = static_cast<uint32_t>(m_buffers.size()) + 1;
+    t_buffer = buffer.get();
+    t_session = m_session;
+    m_buffers.push_back(std::move(buffer));
+    return static_cast<ThreadBuffer*>(t_buffer);
+}
+
+void TraceRecorder::push(const Event& event)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    const uint32_t count = buffer->count.load(std::memory_order_relaxed);
+    if (count == m_eventsPerThread)
+    {
+        ++buffer->dropped;
+        return;
+    }
+    buffer->events[count] = event;
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void TraceRecorder::nameThread(const char* name)
+{
+    if (isEnabled())
+    {
+        threadBuffer()->name = name;
+    }
+}
+
+void TraceRecorder::span(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds)
+{
+    if (isEnabled())
+    {
+        push({name, nullptr, beginNanoseconds, endNanoseconds - beginNanoseconds, EventType::Span});
+    }
+}
+
+void TraceRecorder::gpuSpan(const char* queue, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds)
+{
+    if (isEnabled())
+    {
+        push({name, queue, beginNanoseconds, endNanoseconds - beginNanoseconds, EventType::GpuSpan});
+    }
+}
+
+void TraceRecorder::counter(const char* name, uint64_t nanoseconds, uint64_t value)
+{
+    if (isEnabled())
+    {
+        push({name, nullptr, nanoseconds, value, EventType::Counter});
+    }
+}
+
+void TraceRecorder::calibrateGpuClock(int64_t hostOffset)
+{
+    m_gpuClockOffset = hostOffset;
+    m_gpuClockCalibrated = true;
+}
+
+void TraceRecorder::boundGpuClock(uint64_t submitNanoseconds, uint64_t gpuBeginNanoseconds)
+{
+    if (!m_gpuClockCalibrated)
+    {
+        m_gpuClockOffset = std::max(m_gpuClockOffset, static_cast<int64_t>(submitNanoseconds - gpuBeginNanoseconds));
+    }
+}
+
+bool TraceRecorder::writeToFile(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        printf("Failed to open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const bool hasGpuClock = m_gpuClockOffset != INT64_MIN;
+    std::vector<const char*> gpuTracks;
+    uint64_t eventCount = 0;
+    uint64_t droppedCount = 0;
+
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"CPU\"}}", c_cpuProcessId);
+    fprintf(file, ",\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"GPU\"}}", c_gpuProcessId);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers)
+    {
+        if (buffer->name)
+        {
+            fprintf(file,
+                    ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                    c_cpuProcessId,
+                    buffer->threadId,
+                    buffer->name);
+        }
+
+        const uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Event& event = buffer->events[i];
+            const int64_t time = static_cast<int64_t>(event.time - m_origin);
+            switch (event.type)
+            {
+            case EventType::Span:
+                fprintf(file,
+                        ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                        event.name,
+                        c_cpuProcessId,
+                        buffer->threadId,
+                        toMicroseconds(time),
+                        toMicroseconds(event.value));
+                break;
+            case EventType::GpuSpan:
+            {
+                if (!hasGpuClock)
+                {
+                    continue;
+                }
+                std::vector<const char*>::iterator track = std::find(gpuTracks.begin(), gpuTracks.end(), event.track);
+                if (track == gpuTracks.end())
+                {
+                    track = gpuTracks.insert(gpuTracks.end(), event.track);
+                    fprintf(file,
+                            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                            c_gpuProcessId,
+                            static_cast<int>(track - gpuTracks.begin()) + 1,
+                            event.track);
+                }
+                fprintf(file,
+                        ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                        event.name,
+                        c_gpuProcessId,
+                        static_cast<int>(track - gpuTracks.begin()) + 1,
+                        toMicroseconds(time + m_gpuClockOffset),
+                        toMicroseconds(event.value));
+                break;
+            }
+            case EventType::Counter:
+                fprintf(file,
+                        ",\n{\"name\": \"%s\", \"ph\": \"C\", \"pid\": %d, \"ts\": %.3f, \"args\": {\"value\": %llu}}",
+                        event.name,
+                        c_cpuProcessId,
+                        toMicroseconds(time),
+                        static_cast<unsigned long long>(event.value));
+                break;
+            }
+            ++eventCount;
+        }
+        droppedCount += buffer->dropped;
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Trace: %llu events written to %s", static_cast<unsigned long long>(eventCount), path.c_str());
+    if (droppedCount > 0)
+    {
+        printf(", %llu dropped on full buffers", static_cast<unsigned long long>(droppedCount));
+    }
+    printf("%s\n", hasGpuClock ? (m_gpuClockCalibrated ? "" : ", GPU clock estimated from submit times") : ", no GPU clock");
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records CPU spans, GPU spans and counters and writes them as Chrome Trace Event JSON, which Perfetto and
+// chrome://tracing load. Every thread appends to its own fixed-size buffer without locking, so recording is a
+// few stores when enabled and a single branch when not. Names must be string literals or otherwise outlive the
+// recorder since only the pointer is stored.
+class TraceRecorder
+{
+public:
+    // Events past eventsPerThread on a thread are dropped and counted
+    void create(uint32_t eventsPerThread);
+    void destroy();
+
+    bool isEnabled() const { return m_eventsPerThread != 0; }
+
+    // Names the calling thread's track
+    void nameThread(const char* name);
+    // Span on the calling thread in hostNanoseconds() time
+    void span(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+    // Span on the track of the given queue in nanoseconds of the device timestamp clock
+    void gpuSpan(const char* queue, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+    void counter(const char* name, uint64_t nanoseconds, uint64_t value);
+
+    // Exact offset from the device timestamp clock to hostNanoseconds(), e.g. from VK_EXT_calibrated_timestamps
+    void calibrateGpuClock(int64_t hostOffset);
+    // Without calibration the offset is bounded from below by the GPU work not starting before it was
+    // submitted, and the tightest bound seen is used. Must be called from one thread only.
+    void boundGpuClock(uint64_t submitNanoseconds, uint64_t gpuBeginNanoseconds);
+
+    // The recording threads must not record concurrently
+    bool writeToFile(const std::string& path);
+
+private:
+    enum class EventType : uint8_t
+    {
+        Span,
+        GpuSpan,
+        Counter
+    };
+
+    struct Event
+    {
+        const char* name;
+        // Queue of a GPU span
+        const char* track;
+        uint64_t time;
+        // Duration of a span, value of a counter
+        uint64_t value;
+        EventType type;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        // Written by the owning thread only, read by writeToFile()
+        std::atomic<uint32_t> count{0};
+        uint32_t dropped = 0;
+        uint32_t threadId = 0;
+        const char* name = nullptr;
+    };
+
+    ThreadBuffer* threadBuffer();
+    void push(const Event& event);
+
+    uint32_t m_eventsPerThread = 0;
+    uint64_t m_session = 0;
+    uint64_t m_origin = 0;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    int64_t m_gpuClockOffset = INT64_MIN;
+    bool m_gpuClockCalibrated = false;
+};
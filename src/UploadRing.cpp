@@ -0,0 +1,125 @@
+#include "UploadRing.hpp"
+#include "Common.hpp"
+
+namespace
+{
+// Covers optimalBufferCopyOffsetAlignment on every implementation
+const VkDeviceSize c_alignment = 256;
+} // namespace
+
+void UploadRing::create(VkDevice device,
+                        MemoryArena& memoryArena,
+                        VkDeviceSize capacity,
+                        VkDeviceSize destinationSize,
+                        uint32_t maxCopiesPerFrame)
+{
+    m_device = device;
+    m_memoryArena = &memoryArena;
+    m_capacity = capacity;
+
+    m_stagingAllocation = m_memoryArena->createBuffer(m_capacity,
+                                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                      m_stagingBuffer);
+    m_destinationAllocation = m_memoryArena->createBuffer(destinationSize,
+                                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                          m_destinationBuffer);
+
+    m_copies.reserve(maxCopiesPerFrame);
+    m_head = 0;
+    m_tail = 0;
+    resetCounters();
+}
+
+void UploadRing::destroy()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    m_memoryArena->destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+    m_memoryArena->destroyBuffer(m_destinationBuffer, m_destinationAllocation);
+    m_pending.clear();
+    m_copies.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void UploadRing::reclaim(uint64_t completedValue)
+{
+    while (!m_pending.empty() && m_pending.front().value <= completedValue)
+    {
+        m_tail = m_pending.front().end;
+        m_pending.pop_front();
+    }
+}
+
+bool UploadRing::allocate(VkDeviceSize size, Region& region)
+{
+    const VkDeviceSize alignedSize = (size + c_alignment - 1) / c_alignment * c_alignment;
+    CHECK(alignedSize <= m_capacity);
+
+    // A region can't wrap around, so the rest of the ring is skipped if it doesn't fit before the end
+    const VkDeviceSize offset = m_head % m_capacity;
+    const VkDeviceSize skip = offset + alignedSize > m_capacity ? m_capacity - offset : 0;
+    if (m_head + skip + alignedSize - m_tail > m_capacity)
+    {
+        ++m_stalls;
+        return false;
+    }
+
+    m_head += skip;
+    region.offset = m_head % m_capacity;
+    region.size = size;
+    region.data = m_stagingAllocation.data + region.offset;
+    m_head += alignedSize;
+    return true;
+}
+
+uint64_t UploadRing::oldestPendingValue() const
+{
+    // Nothing to wait for means a single frame's uploads don't fit in the ring
+    CHECK(!m_pending.empty());
+    return m_pending.front().value;
+}
+
+void UploadRing::copy(const Region& region, VkDeviceSize destinationOffset)
+{
+    CHECK(m_copies.size() < m_copies.capacity());
+    VkBufferCopy bufferCopy{};
+    bufferCopy.srcOffset = region.offset;
+    bufferCopy.dstOffset = destinationOffset;
+    bufferCopy.size = region.size;
+    m_copies.push_back(bufferCopy);
+}
+
+void UploadRing::cmdCopy(VkCommandBuffer cb, uint64_t submitValue)
+{
+    if (m_copies.empty())
+    {
+        return;
+    }
+
+    // The previous frame's copies wrote the same destination ranges
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(cb, m_stagingBuffer, m_destinationBuffer, ui32Size(m_copies), m_copies.data());
+    for (const VkBufferCopy& bufferCopy : m_copies)
+    {
+        m_bytesCopied += bufferCopy.size;
+    }
+    m_copies.clear();
+
+    m_pending.push_back({submitValue, m_head});
+}
+
+void UploadRing::resetCounters()
+{
+    m_bytesCopied = 0;
+    m_stalls = 0;
+}
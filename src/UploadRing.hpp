@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MemoryArena.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Persistently mapped staging ring for streaming data to a device-local buffer. Uploads take a region by
+// bumping the write pointer and their copies are recorded into the frame's command buffer. The regions a frame
+// used are reclaimed once the value of its submission has completed, so uploading needs no allocations or
+// fences. When the ring is full the caller waits for oldestPendingValue(), which is counted as a stall.
+class UploadRing
+{
+public:
+    struct Region
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        char* data;
+    };
+
+    void create(VkDevice device,
+                MemoryArena& memoryArena,
+                VkDeviceSize capacity,
+                VkDeviceSize destinationSize,
+                uint32_t maxCopiesPerFrame);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    // Frees the regions of every frame whose submission value has been reached
+    void reclaim(uint64_t completedValue);
+    // Returns false if the ring has no room for size bytes
+    bool allocate(VkDeviceSize size, Region& region);
+    // Submission value the oldest regions in use wait for
+    uint64_t oldestPendingValue() const;
+    // Queues a copy of the region to the destination buffer, recorded by the next cmdCopy()
+    void copy(const Region& region, VkDeviceSize destinationOffset);
+    // Records the queued copies and ties their regions to the value the command buffer's submission signals
+    void cmdCopy(VkCommandBuffer cb, uint64_t submitValue);
+
+    uint64_t bytesCopied() const { return m_bytesCopied; }
+    uint64_t stalls() const { return m_stalls; }
+    void resetCounters();
+
+private:
+    struct PendingFrame
+    {
+        uint64_t value;
+        // Write position after the frame's last region, everything before it is freed with the frame
+        uint64_t end;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    MemoryArena* m_memoryArena = nullptr;
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_stagingAllocation{};
+    VkBuffer m_destinationBuffer = VK_NULL_HANDLE;
+    MemoryArena::Allocation m_destinationAllocation{};
+    VkDeviceSize m_capacity = 0;
+    // Total bytes ever allocated and freed, the ring offsets are these modulo the capacity
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    std::deque<PendingFrame> m_pending;
+    // Reserved up front so that queueing copies doesn't allocate
+    std::vector<VkBufferCopy> m_copies;
+    uint64_t m_bytesCopied = 0;
+    uint64_t m_stalls = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Compute pipeline of workload.comp, which runs an ALU loop over a storage buffer of four floats per element.
+// The buffer is bound by a descriptor set of descriptorSetLayout(), the caller owns the pool it comes from.
+class WorkloadPipeline
+{
+public:
+    // Matches the push constant block of workload.comp and workload.frag
+    struct PushConstants
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t iterations;
+        uint32_t index;
+    };
+
+    void create(VkDevice device);
+    void destroy();
+
+    bool isEnabled() const { return m_device != VK_NULL_HANDLE; }
+
+    VkDescriptorSetLayout descriptorSetLayout() const { return m_descriptorSetLayout; }
+    // Allocates a set that binds the whole buffer, pool needs one storage buffer descriptor for it
+    VkDescriptorSet allocateDescriptorSet(VkDescriptorPool pool, VkBuffer buffer) const;
+
+    // Binds the pipeline and descriptorSet for the following dispatches
+    void cmdBind(VkCommandBuffer cb, VkDescriptorSet descriptorSet) const;
+    // Runs iterations per element over a buffer of width * height elements, index varies the result per dispatch
+    void cmdDispatch(VkCommandBuffer cb, uint32_t width, uint32_t height, uint32_t iterations, uint32_t index) const;
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
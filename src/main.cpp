@@ -1,90 +1,52 @@
+#include "Common.hpp"
+#include "DeviceContext.hpp"
+#include "FrameGraphBenchmark.hpp"
+#include "MemoryArena.hpp"
+#include "Options.hpp"
+#include "SemaphoreStress.hpp"
+#include "SharedTimeline.hpp"
+#include "StartupProfiler.hpp"
+#include "Timing.hpp"
+#include "Trace.hpp"
+
 #include <cstdio>
 #include <vector>
 #include <cstdlib>
-#include <array>
-#include <set>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <random>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-struct QueueFamilyIndices
-{
-    int graphicsFamily = -1;
-    int computeFamily = -1;
-    int presentFamily = -1;
-};
-
 VkInstance m_instance;
+bool m_headless = false;
 #ifdef _MSC_VER
 VkDebugUtilsMessengerEXT m_debugMessenger;
 #endif
 GLFWwindow* m_window;
-bool m_shouldQuit = false;
 VkSurfaceKHR m_surface;
-QueueFamilyIndices m_queueFamilyIndices;
-VkRenderPass m_renderPass;
-VkSwapchainKHR m_swapchain;
-std::vector<VkImage> m_swapchainImages;
-std::vector<VkImageView> m_swapchainImageViews;
-std::vector<VkFramebuffer> m_framebuffers;
 VkPhysicalDevice m_physicalDevice;
-VkDevice m_device;
-VkQueue m_graphicsQueue;
-VkQueue m_presentQueue;
-VkCommandPool m_graphicsCommandPool;
-VkCommandBuffer m_commandBuffer;
-std::vector<VkSemaphore> m_imageAvailableBinarySemaphores;
-std::vector<VkSemaphore> m_renderFinishedBinarySemaphores;
-std::vector<VkSemaphore> m_timelineSemaphores;
-VkFence m_fence;
-
-#define ENABLE_TIMELINE_SEMAPHORES
+// The device everything but --all-devices runs on
+DeviceContext m_context;
+StartupProfiler m_startupProfiler;
+TraceRecorder m_trace;
 
-#ifdef _MSC_VER
-const std::vector<const char*> c_validationLayers{"VK_LAYER_KHRONOS_validation"};
-#else
-const std::vector<const char*> c_validationLayers{};
-#endif
 const std::vector<const char*> c_instanceExtensions{VK_EXT_DEBUG_UTILS_EXTENSION_NAME};
-const std::vector<const char*> c_deviceExtensions{
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME, //
-#ifdef ENABLE_TIMELINE_SEMAPHORES
-    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME //
-#endif
-};
-const VkPresentModeKHR c_presentMode = VK_PRESENT_MODE_FIFO_KHR;
-const int c_windowWidth = 800;
-const int c_windowHeight = 600;
-const VkSurfaceFormatKHR c_windowSurfaceFormat{VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
-const VkExtent2D c_windowExtent{c_windowWidth, c_windowHeight};
-const uint32_t c_swapchainImageCount = 3;
-const uint64_t c_timeout = 10000000000;
-
-#define VK_CHECK(f)                                                                             \
-    do                                                                                          \
-    {                                                                                           \
-        const VkResult result = (f);                                                            \
-        if (result != VK_SUCCESS)                                                               \
-        {                                                                                       \
-            printf("Abort. %s failed at %s:%d. Result = %d\n", #f, __FILE__, __LINE__, result); \
-            abort();                                                                            \
-        }                                                                                       \
-    } while (false)
-
-#define CHECK(f)                                                           \
-    do                                                                     \
-    {                                                                      \
-        if (!(f))                                                          \
-        {                                                                  \
-            printf("Abort. %s failed at %s:%d\n", #f, __FILE__, __LINE__); \
-            abort();                                                       \
-        }                                                                  \
-    } while (false)
-
-template<typename T>
-uint32_t ui32Size(const T& container)
-{
-    return static_cast<uint32_t>(container.size());
-}
+// Time each semaphore stress configuration runs for
+const double c_stressSeconds = 0.25;
+// Time each frame graph shape runs for, on one and on two queues
+const double c_frameGraphSeconds = 0.25;
+// Longest chain of passes in the frame graph benchmark
+const uint32_t c_frameGraphMaxDepth = 64;
+// Frames of transient resources each memory arena benchmark mode creates
+const uint32_t c_arenaBenchmarkFrames = 64;
+// Time the concurrent device benchmark runs for unless --frames or --duration is given
+const double c_allDevicesSeconds = 2.0;
+// About 10 MB per recording thread, a few tens of thousands of frames on the main thread
+const uint32_t c_traceEventsPerThread = 256 * 1024;
 
 #ifdef _MSC_VER
 VKAPI_ATTR VkBool32 VKAPI_CALL debugUtilsCallback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
@@ -110,47 +72,6 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debugUtilsCallback(VkDebugUtilsMessageSeverityFla
 }
 #endif
 
-bool hasAllQueueFamilies(const QueueFamilyIndices& indices)
-{
-    return indices.graphicsFamily != -1 && indices.computeFamily != -1 && indices.presentFamily != -1;
-}
-
-void getQueueFamilies()
-{
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
-
-    QueueFamilyIndices indices;
-    for (unsigned int i = 0; i < queueFamilies.size(); ++i)
-    {
-        if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-        {
-            indices.graphicsFamily = i;
-        }
-
-        if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT)
-        {
-            indices.computeFamily = i;
-        }
-
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, i, m_surface, &presentSupport);
-        if (queueFamilies[i].queueCount > 0 && presentSupport)
-        {
-            indices.presentFamily = i;
-        }
-
-        if (hasAllQueueFamilies(indices))
-        {
-            break;
-        }
-    }
-
-    m_queueFamilyIndices = indices;
-}
-
 void glfwErrorCallback(int error, const char* description)
 {
     printf("GLFW error %d: %s\n", error, description);
@@ -187,12 +108,15 @@ void createInstance()
 #endif
 
     std::vector<const char*> instanceExtensions;
-    unsigned int glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+    if (!m_headless)
     {
-        instanceExtensions.push_back(glfwExtensions[i]);
+        unsigned int glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+        {
+            instanceExtensions.push_back(glfwExtensions[i]);
+        }
     }
 
     instanceExtensions.insert(instanceExtensions.end(), c_instanceExtensions.begin(), c_instanceExtensions.end());
@@ -217,28 +141,39 @@ void createInstance()
 #endif
 }
 
-void handleKey(GLFWwindow* /*window*/, int key, int /*scancode*/, int action, int /*mods*/)
+void handleKey(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/)
 {
     if (action == GLFW_RELEASE && key == GLFW_KEY_ESCAPE)
     {
-        m_shouldQuit = true;
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
 }
 
+void handleFramebufferResize(GLFWwindow* window, int /*width*/, int /*height*/)
+{
+    static_cast<DeviceContext*>(glfwGetWindowUserPointer(window))->markSwapchainDirty();
+}
+
 void createWindow()
 {
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    m_window = glfwCreateWindow(c_windowWidth, c_windowHeight, "Vulkan", nullptr, nullptr);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    const VkExtent2D extent = DeviceContext::c_windowExtent;
+    m_window = glfwCreateWindow(static_cast<int>(extent.width), static_cast<int>(extent.height), "Vulkan", nullptr, nullptr);
     CHECK(m_window);
     glfwSetWindowPos(m_window, 200, 200);
 
+    glfwSetWindowUserPointer(m_window, &m_context);
     glfwSetKeyCallback(m_window, handleKey);
+    glfwSetFramebufferSizeCallback(m_window, handleFramebufferResize);
+}
 
+void createSurface()
+{
     VK_CHECK(glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface));
 }
 
-void getPhysicalDevice()
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices()
 {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
@@ -246,396 +181,637 @@ void getPhysicalDevice()
 
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
-    m_physicalDevice = devices[0];
-    CHECK(m_physicalDevice != VK_NULL_HANDLE);
-
-    VkPhysicalDeviceProperties m_physicalDeviceProperties;
-    vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
-    printf("GPU: %s\n", m_physicalDeviceProperties.deviceName);
+    return devices;
 }
 
-void createDevice()
+// The selector is an index or a case sensitive part of the device name, an empty one picks the first device
+VkPhysicalDevice selectPhysicalDevice(const std::vector<VkPhysicalDevice>& devices, const std::string& selector)
 {
-    const std::set<int> uniqueQueueFamilies = //
+    if (selector.empty())
+    {
+        return devices[0];
+    }
+
+    const bool isIndex = selector.find_first_not_of("0123456789") == std::string::npos;
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+        if (isIndex ? std::to_string(i) == selector : strstr(properties.deviceName, selector.c_str()) != nullptr)
         {
-            m_queueFamilyIndices.graphicsFamily,
-            m_queueFamilyIndices.computeFamily,
-            m_queueFamilyIndices.presentFamily //
-        };
-
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    const float queuePriority = 1.0f;
-    for (int queueFamily : uniqueQueueFamilies)
-    {
-        VkDeviceQueueCreateInfo queueCreateInfo{};
-        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
-        queueCreateInfos.push_back(queueCreateInfo);
-    }
-
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    VkPhysicalDeviceVulkan12Features device12Features{};
-    device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
-#ifdef ENABLE_TIMELINE_SEMAPHORES
-    device12Features.timelineSemaphore = true;
-#endif
+            return devices[i];
+        }
+    }
 
-    VkDeviceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pNext = &device12Features;
-    createInfo.queueCreateInfoCount = ui32Size(queueCreateInfos);
-    createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = ui32Size(c_deviceExtensions);
-    createInfo.ppEnabledExtensionNames = c_deviceExtensions.data();
-    createInfo.enabledLayerCount = ui32Size(c_validationLayers);
-    createInfo.ppEnabledLayerNames = c_validationLayers.data();
-
-    VK_CHECK(vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device));
-
-    vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily, 0, &m_graphicsQueue);
-    vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily, 0, &m_presentQueue);
+    printf("No device matches %s, available devices:\n", selector.c_str());
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+        printf("  %zu: %s\n", i, properties.deviceName);
+    }
+    exit(EXIT_FAILURE);
 }
 
-void createRenderPass()
+void getPhysicalDevice(const std::string& selector)
 {
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = nullptr;
-
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = c_windowSurfaceFormat.format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    const std::vector<VkAttachmentDescription> attachments{colorAttachment};
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = ui32Size(attachments);
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    VK_CHECK(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass));
+    m_physicalDevice = selectPhysicalDevice(enumeratePhysicalDevices(), selector);
+    CHECK(m_physicalDevice != VK_NULL_HANDLE);
+
+    VkPhysicalDeviceProperties m_physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
+    printf("GPU: %s\n", m_physicalDeviceProperties.deviceName);
 }
 
-void createSwapchain()
+std::string statsPathForStrategy(const std::string& path, SyncStrategy strategy, bool paced)
 {
-    VkSwapchainCreateInfoKHR createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    createInfo.surface = m_surface;
-    createInfo.minImageCount = c_swapchainImageCount;
-    createInfo.imageFormat = c_windowSurfaceFormat.format;
-    createInfo.imageColorSpace = c_windowSurfaceFormat.colorSpace;
-    createInfo.imageExtent = c_windowExtent;
-    createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.queueFamilyIndexCount = 0;
-    createInfo.pQueueFamilyIndices = nullptr;
-    createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
-    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = c_presentMode;
-    createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
-
-    VK_CHECK(vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapchain));
-
-    uint32_t queriedImageCount;
-    vkGetSwapchainImagesKHR(m_device, m_swapchain, &queriedImageCount, nullptr);
-    CHECK(queriedImageCount == c_swapchainImageCount);
-    m_swapchainImages.resize(c_swapchainImageCount);
-    vkGetSwapchainImagesKHR(m_device, m_swapchain, &queriedImageCount, m_swapchainImages.data());
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of("/\\");
+    const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    const std::string stem = hasExtension ? path.substr(0, dot) : path;
+    const std::string extension = hasExtension ? path.substr(dot) : "";
+    return stem + "-" + syncStrategyName(strategy) + (paced ? "-paced" : "") + extension;
 }
 
-void createSwapchainImageViews()
+struct BenchmarkRow
 {
-    const VkImageSubresourceRange SubresourceRance{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    SyncStrategy strategy;
+    bool paced;
+    DeviceContext::RunResult result;
+    double cpuMicroseconds;
+    double waitMicroseconds;
+    double frameP99Microseconds;
+    double latencyMicroseconds;
+    double latencyP99Microseconds;
+};
 
-    m_swapchainImageViews.resize(m_swapchainImages.size());
-    for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
+void printBenchmarkTable(const std::vector<BenchmarkRow>& rows)
+{
+    printf("\n%-16s %12s %14s %14s %14s %12s %14s\n",
+           "strategy",
+           "frames/s",
+           "cpu us/frame",
+           "wait us/frame",
+           "p99 frame us",
+           "latency us",
+           "p99 latency us");
+    for (const BenchmarkRow& row : rows)
     {
-        VkImageViewCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.image = m_swapchainImages[i];
-        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        createInfo.format = c_windowSurfaceFormat.format;
-        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.subresourceRange = SubresourceRance;
+        const std::string name = std::string(syncStrategyName(row.strategy)) + (row.paced ? ", paced" : "");
+        printf("%-16s %12.1f %14.2f %14.2f %14.2f %12.2f %14.2f\n",
+               name.c_str(),
+               row.result.seconds > 0.0 ? row.result.frameCount / row.result.seconds : 0.0,
+               row.cpuMicroseconds,
+               row.waitMicroseconds,
+               row.frameP99Microseconds,
+               row.latencyMicroseconds,
+               row.latencyP99Microseconds);
+    }
+}
 
-        VK_CHECK(vkCreateImageView(m_device, &createInfo, nullptr, &m_swapchainImageViews[i]));
+// Powers of four from first up to and including maxValue
+std::vector<uint32_t> stressSweep(uint32_t first, uint32_t maxValue)
+{
+    std::vector<uint32_t> values;
+    for (uint64_t value = first; value < maxValue; value *= 4)
+    {
+        values.push_back(static_cast<uint32_t>(value));
     }
+    values.push_back(maxValue);
+    return values;
 }
 
-void createFramebuffers()
+void runSemaphoreStress(const Options& options)
 {
-    m_framebuffers.resize(m_swapchainImageViews.size());
+    if (!m_context.timelineSemaphoreSupported())
+    {
+        printf("Skipping semaphore stress, timeline semaphores not supported by the device\n");
+        return;
+    }
 
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = m_renderPass;
-    framebufferInfo.width = c_windowWidth;
-    framebufferInfo.height = c_windowHeight;
-    framebufferInfo.layers = 1;
+    SemaphoreStress stress;
+    stress.create(m_context.device(), m_context.graphicsQueue());
 
-    for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
+    std::vector<SemaphoreStress::Result> results;
+    for (uint32_t semaphoreCount : stressSweep(16, options.stressSemaphores))
+    {
+        for (uint32_t chainDepth : stressSweep(1, options.stressDepth))
+        {
+            results.push_back(stress.run(semaphoreCount, chainDepth, c_stressSeconds));
+        }
+    }
+    SemaphoreStress::printResults(results);
+    if (!options.resultsPath.empty())
     {
-        const std::vector<VkImageView> attachments{m_swapchainImageViews[i]};
-        framebufferInfo.attachmentCount = ui32Size(attachments);
-        framebufferInfo.pAttachments = attachments.data();
-        VK_CHECK(vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_framebuffers[i]));
+        std::vector<BenchmarkResult> benchmarkResults;
+        for (const SemaphoreStress::Result& result : results)
+        {
+            const std::string name = "semaphores-" + std::to_string(result.semaphoreCount) + "-depth-" + std::to_string(result.chainDepth);
+            benchmarkResults.push_back({name, result.submitsPerSecond, result.waitAll.percentile(99.0) / 1000.0});
+        }
+        exportBenchmarkResults(options.resultsPath, benchmarkResults);
     }
+
+    stress.destroy();
 }
 
-void createCommandPool()
+void runFrameGraphBenchmark(const Options& options)
 {
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (!m_context.timelineSemaphoreSupported())
+    {
+        printf("Skipping the frame graph benchmark, timeline semaphores not supported by the device\n");
+        return;
+    }
+    if (m_context.computeQueue() == m_context.graphicsQueue())
+    {
+        printf("No separate compute queue, compute passes run on the graphics queue\n");
+    }
 
-    VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_graphicsCommandPool));
+    FrameGraphBenchmark benchmark;
+    benchmark.create(m_context.device(),
+                     m_context.memoryArena(),
+                     m_context.graphicsQueue(),
+                     m_context.graphicsFamily(),
+                     m_context.computeQueue(),
+                     m_context.computeFamily(),
+                     m_context.synchronization2Supported() && !options.legacySubmit,
+                     m_context.framesInFlight());
+
+    std::vector<FrameGraphBenchmark::Result> results;
+    for (uint32_t width : stressSweep(1, options.frameGraphWidth))
+    {
+        for (uint32_t depth : stressSweep(4, c_frameGraphMaxDepth))
+        {
+            results.push_back(benchmark.run(width, depth, c_frameGraphSeconds));
+        }
+    }
+    FrameGraphBenchmark::printResults(results);
+
+    benchmark.destroy();
 }
 
-void allocateCommandBuffer()
+// Transient resource of the memory arena benchmark, a storage buffer or a sampled color attachment
+VkBuffer createArenaBenchmarkBuffer(std::mt19937& random)
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_graphicsCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
+    VkBufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = static_cast<VkDeviceSize>(64 * 1024) << (random() % 7);
+    createInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    VK_CHECK(vkCreateBuffer(m_context.device(), &createInfo, nullptr, &buffer));
+    return buffer;
+}
 
-    VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffer));
+VkImage createArenaBenchmarkImage(std::mt19937& random)
+{
+    const uint32_t size = 128u << (random() % 4);
+
+    VkImageCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    createInfo.imageType = VK_IMAGE_TYPE_2D;
+    createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.extent = {size, size, 1};
+    createInfo.mipLevels = 1;
+    createInfo.arrayLayers = 1;
+    createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImage image;
+    VK_CHECK(vkCreateImage(m_context.device(), &createInfo, nullptr, &image));
+    return image;
 }
 
-void createSemaphores()
+// Creates the same per-frame mix of transient buffers and images with one vkAllocateMemory each and then
+// sub-allocated from the memory arena, timing how long memory takes to get bound per resource. Long-lived
+// allocations are then churned through the arena's free list to show the fragmentation that leaves behind.
+void runMemoryArenaBenchmark(const Options& options)
 {
+    const VkDevice device = m_context.device();
+    const uint32_t resourceCount = options.arenaResources;
+    printf("Memory arena benchmark: %u transient buffers and images per frame, %u frames\n", resourceCount, c_arenaBenchmarkFrames);
+
+    MemoryArena arena;
+    arena.create(device, m_context.physicalDevice(), m_context.framesInFlight());
+
+    std::vector<VkBuffer> buffers;
+    std::vector<VkImage> images;
+    std::vector<VkDeviceMemory> memories;
+    LatencyHistogram dedicated;
+    LatencyHistogram subAllocated;
+    for (int mode = 0; mode < 2; ++mode)
     {
-        m_imageAvailableBinarySemaphores.resize(c_swapchainImageCount);
-        m_renderFinishedBinarySemaphores.resize(c_swapchainImageCount);
+        LatencyHistogram& histogram = mode == 0 ? dedicated : subAllocated;
+        // Same seed in both modes so that they create the same resources
+        std::mt19937 random(1);
+        for (uint32_t frame = 0; frame < c_arenaBenchmarkFrames; ++frame)
+        {
+            const uint32_t frameIndex = frame % m_context.framesInFlight();
+            for (uint32_t i = 0; i < resourceCount; ++i)
+            {
+                VkMemoryRequirements memoryRequirements;
+                const bool image = i % 2 == 1;
+                if (image)
+                {
+                    images.push_back(createArenaBenchmarkImage(random));
+                    vkGetImageMemoryRequirements(device, images.back(), &memoryRequirements);
+                }
+                else
+                {
+                    buffers.push_back(createArenaBenchmarkBuffer(random));
+                    vkGetBufferMemoryRequirements(device, buffers.back(), &memoryRequirements);
+                }
+
+                const uint64_t start = hostNanoseconds();
+                VkDeviceMemory memory;
+                VkDeviceSize offset = 0;
+                if (mode == 0)
+                {
+                    VkMemoryAllocateInfo allocateInfo{};
+                    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                    allocateInfo.allocationSize = memoryRequirements.size;
+                    allocateInfo.memoryTypeIndex = findMemoryType(m_context.physicalDevice(), memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                    VK_CHECK(vkAllocateMemory(device, &allocateInfo, nullptr, &memory));
+                    memories.push_back(memory);
+                }
+                else
+                {
+                    const MemoryArena::Tiling tiling = image ? MemoryArena::Tiling::Optimal : MemoryArena::Tiling::Linear;
+                    const MemoryArena::Allocation allocation = arena.allocateTransient(frameIndex, memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tiling);
+                    memory = allocation.memory;
+                    offset = allocation.offset;
+                }
+                if (image)
+                {
+                    VK_CHECK(vkBindImageMemory(device, images.back(), memory, offset));
+                }
+                else
+                {
+                    VK_CHECK(vkBindBufferMemory(device, buffers.back(), memory, offset));
+                }
+                histogram.add(hostNanoseconds() - start);
+            }
+
+            // Nothing is submitted, so the frame's resources retire right away
+            for (VkBuffer buffer : buffers)
+            {
+                vkDestroyBuffer(device, buffer, nullptr);
+            }
+            for (VkImage image : images)
+            {
+                vkDestroyImage(device, image, nullptr);
+            }
+            for (VkDeviceMemory memory : memories)
+            {
+                vkFreeMemory(device, memory, nullptr);
+            }
+            buffers.clear();
+            images.clear();
+            memories.clear();
+            arena.resetFrame(frameIndex);
+        }
+    }
 
-        VkSemaphoreCreateInfo semaphoreInfo{};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    printf("Bind memory per resource: dedicated mean %.2f us, p99 %.2f us; arena mean %.2f us, p99 %.2f us\n",
+           dedicated.mean() / 1000.0,
+           dedicated.percentile(99.0) / 1000.0,
+           subAllocated.mean() / 1000.0,
+           subAllocated.percentile(99.0) / 1000.0);
 
-        for (size_t i = 0; i < c_swapchainImageCount; ++i)
+    // Frees a random half of the long-lived buffers every round and replaces them with buffers of other sizes
+    std::mt19937 random(2);
+    std::vector<std::pair<VkBuffer, MemoryArena::Allocation>> longLived;
+    for (uint32_t round = 0; round < c_arenaBenchmarkFrames; ++round)
+    {
+        while (longLived.size() < resourceCount)
         {
-            VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableBinarySemaphores[i]));
-            VK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedBinarySemaphores[i]));
+            VkBuffer buffer = createArenaBenchmarkBuffer(random);
+            VkMemoryRequirements memoryRequirements;
+            vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+            const MemoryArena::Allocation allocation = arena.allocate(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryArena::Tiling::Linear);
+            VK_CHECK(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset));
+            longLived.push_back(std::make_pair(buffer, allocation));
         }
+        for (size_t i = 0; i < longLived.size() / 2; ++i)
+        {
+            std::swap(longLived[i], longLived[i + random() % (longLived.size() - i)]);
+            vkDestroyBuffer(device, longLived[i].first, nullptr);
+            arena.free(longLived[i].second);
+        }
+        longLived.erase(longLived.begin(), longLived.begin() + longLived.size() / 2);
     }
+    arena.printStats();
 
-#ifdef ENABLE_TIMELINE_SEMAPHORES
+    for (const std::pair<VkBuffer, MemoryArena::Allocation>& resource : longLived)
     {
-        m_timelineSemaphores.resize(c_swapchainImageCount);
+        vkDestroyBuffer(device, resource.first, nullptr);
+    }
+    arena.destroy();
+}
 
-        VkSemaphoreTypeCreateInfo timelineCreateInfo{};
-        timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
-        timelineCreateInfo.pNext = NULL;
-        timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
-        timelineCreateInfo.initialValue = 0;
+void runSharedTimeline(const Options& options)
+{
+    if (!m_context.externalSemaphoreFdSupported())
+    {
+        printf("Skipping the shared timeline, exporting timeline semaphores as fds is not supported by the device\n");
+        return;
+    }
 
-        VkSemaphoreCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        createInfo.pNext = &timelineCreateInfo;
-        createInfo.flags = 0;
+    const bool producer = options.shareTimeline == "producer";
+    SharedTimeline sharedTimeline;
+    sharedTimeline.create(m_context.device(), m_context.physicalDevice(), m_context.graphicsQueue(), m_context.frameTimeline().semaphore(), producer, options.socketPath);
+    printf("Sharing the timeline as the %s\n", options.shareTimeline.c_str());
 
-        for (size_t i = 0; i < c_swapchainImageCount; ++i)
-        {
-            VK_CHECK(vkCreateSemaphore(m_device, &createInfo, NULL, &m_timelineSemaphores[i]));
-        }
+    const SharedTimeline::Result result = sharedTimeline.run();
+    if (producer)
+    {
+        SharedTimeline::printResult(result);
     }
-#endif
+    sharedTimeline.destroy();
 }
 
-void createFence()
+void destroyResources()
 {
-    VkFenceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    createInfo.pNext = nullptr;
-    createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    m_context.destroy();
+
+    if (!m_headless)
+    {
+        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
 
-    vkCreateFence(m_device, &createInfo, nullptr, &m_fence);
+#ifdef _MSC_VER
+    auto vkDestroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(m_instance, "vkDestroyDebugUtilsMessengerEXT");
+    CHECK(vkDestroyDebugUtilsMessengerEXT);
+    vkDestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
+#endif
+    vkDestroyInstance(m_instance, nullptr);
 }
 
-void destroyResources()
+// Per device rows and their sum, with wallSeconds the time all devices ran concurrently
+void printDeviceTable(const std::vector<DeviceContext*>& contexts, const std::vector<DeviceContext::RunResult>& results, double wallSeconds)
 {
-    vkDeviceWaitIdle(m_device);
-    vkDestroyFence(m_device, m_fence, nullptr);
-    for (size_t i = 0; i < c_swapchainImageCount; ++i)
-    {
-        vkDestroySemaphore(m_device, m_imageAvailableBinarySemaphores[i], nullptr);
-        vkDestroySemaphore(m_device, m_renderFinishedBinarySemaphores[i], nullptr);
-#ifdef ENABLE_TIMELINE_SEMAPHORES
-        vkDestroySemaphore(m_device, m_timelineSemaphores[i], nullptr);
-#endif
+    printf("\n%-32s %10s %12s %14s %14s %14s %14s\n", "device", "frames", "frames/s", "record us", "submit us", "wait us", "p99 frame us");
+    uint64_t totalFrames = 0;
+    for (size_t i = 0; i < contexts.size(); ++i)
+    {
+        const FrameStats& stats = contexts[i]->frameStats();
+        const DeviceContext::RunResult& result = results[i];
+        printf("%-32.32s %10llu %12.1f %14.2f %14.2f %14.2f %14.2f\n",
+               contexts[i]->deviceName().c_str(),
+               static_cast<unsigned long long>(result.frameCount),
+               result.seconds > 0.0 ? result.frameCount / result.seconds : 0.0,
+               stats.phase(FramePhase::Record).mean() / 1000.0,
+               stats.phase(FramePhase::Submit).mean() / 1000.0,
+               stats.phase(FramePhase::Wait).mean() / 1000.0,
+               stats.phase(FramePhase::Frame).percentile(99.0) / 1000.0);
+        totalFrames += result.frameCount;
     }
-    vkDestroyCommandPool(m_device, m_graphicsCommandPool, nullptr);
+    printf("%-32s %10llu %12.1f\n",
+           "total",
+           static_cast<unsigned long long>(totalFrames),
+           wallSeconds > 0.0 ? totalFrames / wallSeconds : 0.0);
+}
 
-    for (const VkFramebuffer& framebuffer : m_framebuffers)
+// Runs the headless frame loop of the selected strategy on every device that supports it at the same time, each
+// with its own context and thread
+void runAllDevices(const Options& options)
+{
+    Options runOptions = options;
+    if (runOptions.frameCount == 0 && runOptions.durationSeconds == 0.0)
     {
-        vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+        runOptions.durationSeconds = c_allDevicesSeconds;
     }
 
-    for (const VkImageView& imageView : m_swapchainImageViews)
+    const std::vector<VkPhysicalDevice> physicalDevices = enumeratePhysicalDevices();
+    // Created in place, a context can't be moved. The traces stay disabled, bounding the GPU clock offset is
+    // single threaded and per device.
+    std::vector<DeviceContext> contexts(physicalDevices.size());
+    std::vector<TraceRecorder> traces(physicalDevices.size());
+    std::vector<DeviceContext*> supportedContexts;
+    for (size_t i = 0; i < physicalDevices.size(); ++i)
     {
-        vkDestroyImageView(m_device, imageView, nullptr);
-    }
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevices[i], &properties);
+        printf("GPU: %s\n", properties.deviceName);
 
-    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+        contexts[i].create(m_instance, physicalDevices[i], nullptr, VK_NULL_HANDLE, runOptions, traces[i], m_startupProfiler);
+        if (!contexts[i].isSyncStrategySupported(runOptions.syncStrategy))
+        {
+            printf("Skipping %s, %s sync not supported by the device\n", properties.deviceName, syncStrategyName(runOptions.syncStrategy));
+            contexts[i].destroy();
+            continue;
+        }
+        supportedContexts.push_back(&contexts[i]);
+    }
+    m_startupProfiler.finish("ready");
+    m_startupProfiler.print();
 
-    vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+    std::vector<DeviceContext::RunResult> results(supportedContexts.size());
+    std::vector<std::thread> threads;
+    const uint64_t startNanoseconds = hostNanoseconds();
+    for (size_t i = 0; i < supportedContexts.size(); ++i)
+    {
+        DeviceContext* context = supportedContexts[i];
+        DeviceContext::RunResult* result = &results[i];
+        threads.push_back(std::thread([context, result, &runOptions]() { *result = context->run(runOptions.syncStrategy, runOptions.pace, runOptions); }));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    const double wallSeconds = (hostNanoseconds() - startNanoseconds) / 1e9;
 
-    vkDestroyDevice(m_device, nullptr);
+    printDeviceTable(supportedContexts, results, wallSeconds);
+    for (DeviceContext& context : contexts)
+    {
+        context.destroy();
+    }
+}
 
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+void createInstanceAndPhysicalDevice(const Options& options)
+{
+    {
+        StartupProfiler::Scope scope(m_startupProfiler, "instance");
+        createInstance();
+    }
+    StartupProfiler::Scope scope(m_startupProfiler, "physical device");
+    getPhysicalDevice(options.device);
+}
 
-#ifdef _MSC_VER
-    auto vkDestroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(m_instance, "vkDestroyDebugUtilsMessengerEXT");
-    CHECK(vkDestroyDebugUtilsMessengerEXT);
-    vkDestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
-#endif
-    vkDestroyInstance(m_instance, nullptr);
+DeviceContext::RunResult runStrategy(SyncStrategy strategy, bool paced, const Options& options)
+{
+    const DeviceContext::RunResult result = m_context.run(strategy, paced, options);
+    m_startupProfiler.print();
+    m_context.printRunStats(strategy, paced, result);
+    return result;
 }
 
-int main(void)
+int main(int argc, char** argv)
 {
-    initGLFW();
-    createInstance();
-    createWindow();
-    getPhysicalDevice();
-    getQueueFamilies();
-    createDevice();
-    createRenderPass();
-    createSwapchain();
-    createSwapchainImageViews();
-    createFramebuffers();
-    createCommandPool();
-    allocateCommandBuffer();
-    createSemaphores();
-    createFence();
-
-    uint64_t semaphoreCounter = 0;
-    uint64_t frameIndex = 0;
-    while (!(glfwWindowShouldClose(m_window) || m_shouldQuit))
-    {
-        uint32_t imageIndex;
-        VK_CHECK(vkAcquireNextImageKHR(m_device, m_swapchain, c_timeout, m_imageAvailableBinarySemaphores[frameIndex], VK_NULL_HANDLE, &imageIndex));
-        VK_CHECK(vkWaitForFences(m_device, 1, &m_fence, true, c_timeout));
-        VK_CHECK(vkResetFences(m_device, 1, &m_fence));
-
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-        beginInfo.pInheritanceInfo = nullptr;
-
-        VkCommandBuffer cb = m_commandBuffer;
-        vkResetCommandBuffer(cb, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-        vkBeginCommandBuffer(cb, &beginInfo);
-
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = {0.0f, 0.0f, 0.2f, 1.0f};
-        clearValues[1].depthStencil = {1.0f, 0};
-
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_framebuffers[imageIndex];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = c_windowExtent;
-        renderPassInfo.clearValueCount = ui32Size(clearValues);
-        renderPassInfo.pClearValues = clearValues.data();
-
-        vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdEndRenderPass(cb);
-
-        VK_CHECK(vkEndCommandBuffer(cb));
-
-        const std::vector<VkPipelineStageFlags> waitStages{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-        ++semaphoreCounter;
-        const std::vector<uint64_t> signalValues(2, semaphoreCounter);
-        void* next = nullptr;
-        std::vector<VkSemaphore> signalSemaphores;
-
-#ifdef ENABLE_TIMELINE_SEMAPHORES
-        signalSemaphores.push_back(m_timelineSemaphores[frameIndex]);
-
-        VkTimelineSemaphoreSubmitInfo timelineInfo{};
-        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
-        timelineInfo.pNext = NULL;
-        timelineInfo.waitSemaphoreValueCount = 0;
-        timelineInfo.pWaitSemaphoreValues = NULL;
-        timelineInfo.signalSemaphoreValueCount = ui32Size(signalValues);
-        timelineInfo.pSignalSemaphoreValues = signalValues.data();
-        next = &timelineInfo;
-#endif
+    const Options options = parseOptions(argc, argv);
+    m_headless = options.headless;
+    // Not with --all-devices, whose devices each have their own GPU clock
+    if (!options.tracePath.empty() && !options.allDevices)
+    {
+        m_trace.create(c_traceEventsPerThread);
+    }
 
-        signalSemaphores.push_back(m_renderFinishedBinarySemaphores[frameIndex]);
+    if (options.allDevices)
+    {
+        {
+            StartupProfiler::Scope scope(m_startupProfiler, "instance");
+            createInstance();
+        }
+        runAllDevices(options);
+        destroyResources();
+        return 0;
+    }
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.pNext = next;
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = &m_imageAvailableBinarySemaphores[frameIndex];
-        submitInfo.pWaitDstStageMask = waitStages.data();
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_commandBuffer;
-        submitInfo.signalSemaphoreCount = ui32Size(signalSemaphores);
-        submitInfo.pSignalSemaphores = signalSemaphores.data();
+    if (m_headless)
+    {
+        createInstanceAndPhysicalDevice(options);
+    }
+    else
+    {
+        {
+            StartupProfiler::Scope scope(m_startupProfiler, "glfw");
+            initGLFW();
+        }
+        // The instance and physical device don't need the window, so they are created while GLFW creates it.
+        // Window creation itself has to stay on the main thread.
+        std::thread instanceThread(createInstanceAndPhysicalDevice, std::cref(options));
+        {
+            StartupProfiler::Scope scope(m_startupProfiler, "window");
+            createWindow();
+        }
+        instanceThread.join();
+
+        StartupProfiler::Scope scope(m_startupProfiler, "surface");
+        createSurface();
+    }
+    // The window and surface stay null in headless mode
+    m_context.create(m_instance, m_physicalDevice, m_window, m_surface, options, m_trace, m_startupProfiler);
 
-        VK_CHECK(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_fence));
+    if (!options.shareTimeline.empty())
+    {
+        m_startupProfiler.finish("ready");
+        m_startupProfiler.print();
+        runSharedTimeline(options);
+        destroyResources();
+        return 0;
+    }
+    if (options.stressSemaphores > 0)
+    {
+        m_startupProfiler.finish("ready");
+        m_startupProfiler.print();
+        runSemaphoreStress(options);
+        destroyResources();
+        return 0;
+    }
+    if (options.frameGraphWidth > 0)
+    {
+        m_startupProfiler.finish("ready");
+        m_startupProfiler.print();
+        runFrameGraphBenchmark(options);
+        destroyResources();
+        return 0;
+    }
+    if (options.arenaResources > 0)
+    {
+        m_startupProfiler.finish("ready");
+        m_startupProfiler.print();
+        runMemoryArenaBenchmark(options);
+        destroyResources();
+        return 0;
+    }
 
-        VkPresentInfoKHR presentInfo{};
-        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &m_renderFinishedBinarySemaphores[frameIndex];
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = &m_swapchain;
-        presentInfo.pImageIndices = &imageIndex;
-        presentInfo.pResults = nullptr;
+    std::vector<SyncStrategy> strategies;
+    if (options.benchmark)
+    {
+        for (int i = 0; i < static_cast<int>(SyncStrategy::Count); ++i)
+        {
+            strategies.push_back(static_cast<SyncStrategy>(i));
+        }
+    }
+    else
+    {
+        strategies.push_back(options.syncStrategy);
+    }
 
-        VK_CHECK(vkQueuePresentKHR(m_presentQueue, &presentInfo));
+    std::vector<BenchmarkRow> rows;
+    bool quit = false;
+    for (SyncStrategy strategy : strategies)
+    {
+        if (!m_context.isSyncStrategySupported(strategy))
+        {
+            printf("Skipping %s sync, not supported by the device\n", syncStrategyName(strategy));
+            continue;
+        }
 
-        glfwPollEvents();
+        // With --pace every strategy runs unpaced first so that the two can be compared
+        for (int pass = options.pace ? 0 : 1; pass < 2 && !quit; ++pass)
+        {
+            const bool paced = options.pace && pass == 1;
+
+            BenchmarkRow row;
+            row.strategy = strategy;
+            row.paced = paced;
+            row.result = runStrategy(strategy, paced, options);
+
+            // Time spent delayed by the pacer counts as waiting rather than CPU work
+            const FrameStats& frameStats = m_context.frameStats();
+            const LatencyHistogram& frame = frameStats.phase(FramePhase::Frame);
+            const double waitMean = frameStats.phase(FramePhase::Wait).mean() + frameStats.phase(FramePhase::Pace).mean();
+            const LatencyHistogram& latency = frameStats.phase(FramePhase::Latency);
+            row.cpuMicroseconds = (frame.mean() - waitMean) / 1000.0;
+            row.waitMicroseconds = waitMean / 1000.0;
+            row.frameP99Microseconds = frame.percentile(99.0) / 1000.0;
+            row.latencyMicroseconds = latency.mean() / 1000.0;
+            row.latencyP99Microseconds = latency.percentile(99.0) / 1000.0;
+            rows.push_back(row);
+
+            if (!options.statsPath.empty())
+            {
+                const bool perRun = options.benchmark || options.pace;
+                frameStats.exportToFile(perRun ? statsPathForStrategy(options.statsPath, strategy, paced) : options.statsPath);
+            }
+
+            quit = !m_headless && glfwWindowShouldClose(m_window);
+        }
+        if (quit)
+        {
+            break;
+        }
+    }
 
-        ++frameIndex;
-        if (frameIndex == c_swapchainImageCount)
+    if (options.benchmark || options.pace)
+    {
+        printBenchmarkTable(rows);
+    }
+    if (!options.resultsPath.empty())
+    {
+        std::vector<BenchmarkResult> results;
+        for (const BenchmarkRow& row : rows)
         {
-            frameIndex = 0;
+            const std::string name = std::string(syncStrategyName(row.strategy)) + (row.paced ? "-paced" : "");
+            results.push_back({name, row.result.seconds > 0.0 ? row.result.frameCount / row.result.seconds : 0.0, row.frameP99Microseconds});
         }
+        exportBenchmarkResults(options.resultsPath, results);
     }
 
     destroyResources();
+    // After destroyResources() so that every thread that records has stopped
+    if (m_trace.isEnabled())
+    {
+        m_trace.writeToFile(options.tracePath);
+        m_trace.destroy();
+    }
 
     return 0;
-}
\ No newline at end of file
+}